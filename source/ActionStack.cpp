@@ -1,22 +1,106 @@
 #include "ActionStack.h"
 #include "Global.h"
-#include <list>
 
-static std::list<Action> sRedoStack;
-static std::list<Action> sUndoStack;
+#include <algorithm>
+
+static size_t sBudget = 16 << 20;
+
+static ActionHistory &action_stack_history(void)
+{
+    return global.document->history;
+}
+
+static size_t action_stack_bytes(const ActionHistory &h)
+{
+    return (h.arena.size() - h.arenaBase) * sizeof(TileDelta) + h.actions.size() * sizeof(ActionRecord);
+}
+
+static void action_stack_evict(ActionHistory &h)
+{
+    while (h.cursor > 0 && action_stack_bytes(h) > sBudget)
+    {
+        h.arenaBase = h.actions.front().begin + h.actions.front().count;
+        h.actions.pop_front();
+        --h.cursor;
+    }
+
+    if (h.arenaBase > h.arena.size() / 2)
+    {
+        h.arena.erase(h.arena.begin(), h.arena.begin() + h.arenaBase);
+        for (auto &action : h.actions) action.begin -= h.arenaBase;
+        h.arenaBase = 0;
+    }
+}
+
+static void apply_tile(unsigned int index, unsigned short tile)
+{
+    auto &tilemap = global.document->tilemap;
+    tilemap_set(tilemap, index % tilemap.width, index / tilemap.width, tile);
+}
 
 void action_stack_clear(void)
 {
-    sUndoStack.clear();
-    sRedoStack.clear();
+    action_stack_history() = ActionHistory();
+}
+
+void action_stack_set_budget(size_t bytes)
+{
+    sBudget = bytes;
+    action_stack_evict(action_stack_history());
+}
+
+bool action_stack_can_undo(void) { return action_stack_history().cursor > 0; }
+bool action_stack_can_redo(void) { return action_stack_history().cursor < action_stack_history().actions.size(); }
+
+// Accumulates a change into the current stroke, keeping the first old and the
+// last new value of every cell.
+void action_stack_record(unsigned int index, unsigned short oldTile, unsigned short newTile)
+{
+    auto &h = action_stack_history();
+    auto [it, inserted] = h.strokeSlots.try_emplace(index, h.stroke.size());
+
+    if (inserted)
+        h.stroke.push_back({ index, oldTile, newTile });
+    else
+        h.stroke[it->second].newTile = newTile;
 }
 
-bool action_stack_can_undo(void) { return !sUndoStack.empty(); }
-bool action_stack_can_redo(void) { return !sRedoStack.empty(); }
+void action_stack_end_stroke(void)
+{
+    auto &h = action_stack_history();
+    action_stack_add_undo_action(h.stroke.data(), h.stroke.size());
+    h.stroke.clear();
+    h.strokeSlots.clear();
+}
 
-void action_stack_add_undo_action(Action action)
+// An action that changes nothing is dropped before the redo history is
+// cut, so an empty stroke, e.g. a click outside the map, keeps it.
+void action_stack_add_undo_action(const TileDelta *deltas, size_t count)
 {
-    sUndoStack.push_back(action);
+    if (std::none_of(deltas, deltas + count, [](const TileDelta &delta) { return delta.oldTile != delta.newTile; }))
+        return;
+
+    auto &h = action_stack_history();
+
+    size_t end = h.cursor > 0 ? h.actions[h.cursor - 1].begin + h.actions[h.cursor - 1].count : h.arenaBase;
+    h.actions.resize(h.cursor);
+    h.arena.resize(end);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (deltas[i].oldTile != deltas[i].newTile)
+            h.arena.push_back(deltas[i]);
+    }
+
+    h.actions.push_back({ end, h.arena.size() - end });
+    h.cursor = h.actions.size();
+
+    global.document->unsaved = true;
+
+    if (const char *error = journal_append(global.document->journal, &h.arena[end], h.arena.size() - end, false))
+        global.statusText = error;
+
+    action_stack_evict(h);
 }
 
 void action_stack_do_undo(void)
@@ -24,11 +108,16 @@ void action_stack_do_undo(void)
     if (!action_stack_can_undo()) 
         return;
 
-    Action action = sUndoStack.back();
-    sUndoStack.pop_back();
+    auto &h = action_stack_history();
+    const auto &action = h.actions[--h.cursor];
 
-    memcpy(global.tilemap, action.oldTiles, sizeof(global.tilemap));
-    sRedoStack.push_back(action);
+    for (size_t i = action.count; i-- > 0;)
+        apply_tile(h.arena[action.begin + i].index, h.arena[action.begin + i].oldTile);
+
+    global.document->unsaved = true;
+
+    if (const char *error = journal_append(global.document->journal, &h.arena[action.begin], action.count, true))
+        global.statusText = error;
 }
 
 void action_stack_do_redo(void)
@@ -36,9 +125,14 @@ void action_stack_do_redo(void)
     if (!action_stack_can_redo()) 
         return;
 
-    Action action = sRedoStack.back();
-    sRedoStack.pop_back();
+    auto &h = action_stack_history();
+    const auto &action = h.actions[h.cursor++];
+
+    for (size_t i = 0; i < action.count; ++i)
+        apply_tile(h.arena[action.begin + i].index, h.arena[action.begin + i].newTile);
+
+    global.document->unsaved = true;
 
-    memcpy(global.tilemap, action.newTiles, 32 * 32 * sizeof(unsigned short));
-    sUndoStack.push_back(action);
+    if (const char *error = journal_append(global.document->journal, &h.arena[action.begin], action.count, false))
+        global.statusText = error;
 }
@@ -1,18 +1,43 @@
 #pragma once
 
 #include <vector>
+#include <deque>
+#include <unordered_map>
+#include <cstddef>
 
-struct Action;
-using ActionFunc = void(*)(const Action &, bool undo);
+struct TileDelta
+{
+    unsigned int index;
+    unsigned short oldTile, newTile;
+};
+
+struct ActionRecord
+{
+    size_t begin, count;
+};
 
-struct Action
+// Undo history of one document. All actions share one arena of deltas.
+// Evicted actions leave a dead prefix that is compacted once it outgrows the
+// live part.
+struct ActionHistory
 {
-    unsigned short oldTiles[32 * 32], newTiles[32 * 32];
+    std::vector<TileDelta> arena;
+    size_t arenaBase = 0;
+    std::deque<ActionRecord> actions;
+    size_t cursor = 0;
+
+    std::vector<TileDelta> stroke;
+    std::unordered_map<unsigned int, size_t> strokeSlots;
 };
 
+// These operate on the history of the active document. The budget applies to
+// each document separately.
 void action_stack_clear(void);
+void action_stack_set_budget(size_t bytes);
 bool action_stack_can_undo(void);
 bool action_stack_can_redo(void);
-void action_stack_add_undo_action(Action action);
+void action_stack_record(unsigned int index, unsigned short oldTile, unsigned short newTile);
+void action_stack_end_stroke(void);
+void action_stack_add_undo_action(const TileDelta *deltas, size_t count);
 void action_stack_do_undo(void);
 void action_stack_do_redo(void);
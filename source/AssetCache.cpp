@@ -0,0 +1,117 @@
+#include "AssetCache.h"
+#include "Renderer.h"
+
+#include <cstring>
+#include <unordered_map>
+
+static std::unordered_map<uint64_t, std::weak_ptr<const TilesetAsset>> sTilesets;
+static std::unordered_map<uint64_t, std::weak_ptr<const PaletteAsset>> sPalettes;
+
+// FNV-1a
+static uint64_t asset_cache_hash(uint64_t hash, const void *data, size_t size)
+{
+    auto bytes = static_cast<const unsigned char *>(data);
+
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+
+    return hash;
+}
+
+static constexpr uint64_t sHashSeed = 0xCBF29CE484222325ull;
+
+static uint64_t asset_cache_key(const Tileset &tileset)
+{
+    uint64_t hash = asset_cache_hash(sHashSeed, tileset.tiles, sizeof(tileset.tiles));
+    hash = asset_cache_hash(hash, tileset.sheetLoaded, sizeof(tileset.sheetLoaded));
+
+    for (const auto &palette : tileset.sheetPalettes)
+        hash = asset_cache_hash(hash, palette.data(), palette.size());
+
+    return hash;
+}
+
+static bool asset_cache_equal(const Tileset &a, const Tileset &b)
+{
+    return memcmp(a.tiles, b.tiles, sizeof(a.tiles)) == 0 &&
+           a.sheetLoaded[0] == b.sheetLoaded[0] && a.sheetLoaded[1] == b.sheetLoaded[1] &&
+           a.sheetPalettes[0] == b.sheetPalettes[0] && a.sheetPalettes[1] == b.sheetPalettes[1];
+}
+
+// The deleter drops the cache entry unless a colliding asset replaced it.
+template<class T>
+static void asset_cache_release(std::unordered_map<uint64_t, std::weak_ptr<const T>> &cache, T *asset)
+{
+    auto it = cache.find(asset->key);
+    if (it != cache.end() && it->second.expired())
+        cache.erase(it);
+
+    renderer_delete_texture(asset->texture);
+    delete asset;
+}
+
+TilesetRef asset_cache_tileset(Renderer &r, const Tileset &tileset)
+{
+    uint64_t key = asset_cache_key(tileset);
+
+    if (auto it = sTilesets.find(key); it != sTilesets.end())
+    {
+        if (auto asset = it->second.lock(); asset && asset_cache_equal(asset->tileset, tileset))
+            return asset;
+    }
+
+    auto *asset = new TilesetAsset;
+    asset->key = key;
+    asset->tileset = tileset;
+    raster_prepare_tiles(tileset, asset->raster);
+    asset->texture = renderer_create_tileset_texture(r, tileset);
+
+    TilesetRef ref(asset, [](TilesetAsset *asset) { asset_cache_release(sTilesets, asset); });
+    sTilesets[key] = ref;
+    return ref;
+}
+
+// Slots that were not loaded are cleared first, so they never affect the key.
+PaletteRef asset_cache_palettes(Renderer &r, const Palette palettes[16], unsigned int loadedMask)
+{
+    Palette content[16] = {};
+
+    for (int i = 0; i < 16; ++i)
+    {
+        if (loadedMask & (1 << i))
+            memcpy(content[i], palettes[i], sizeof(Palette));
+    }
+
+    uint64_t key = asset_cache_hash(sHashSeed, content, sizeof(content));
+    key = asset_cache_hash(key, &loadedMask, sizeof(loadedMask));
+
+    if (auto it = sPalettes.find(key); it != sPalettes.end())
+    {
+        if (auto asset = it->second.lock(); asset && asset->loadedMask == loadedMask && memcmp(asset->palettes, content, sizeof(content)) == 0)
+            return asset;
+    }
+
+    auto *asset = new PaletteAsset;
+    asset->key = key;
+    asset->loadedMask = loadedMask;
+    memcpy(asset->palettes, content, sizeof(content));
+
+    raster_reset_palettes(asset->raster);
+    for (int i = 0; i < 16; ++i)
+    {
+        if (loadedMask & (1 << i))
+            raster_set_palette(asset->raster, i, content[i]);
+    }
+
+    asset->texture = renderer_create_palette_texture(r, content, loadedMask);
+
+    PaletteRef ref(asset, [](PaletteAsset *asset) { asset_cache_release(sPalettes, asset); });
+    sPalettes[key] = ref;
+    return ref;
+}
+
+void asset_cache_stats(int &tilesets, int &palettes)
+{
+    tilesets = static_cast<int>(sTilesets.size());
+    palettes = static_cast<int>(sPalettes.size());
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Raster.h"
+#include "Tileset.h"
+#include "Utils.h"
+
+#include <cstdint>
+#include <memory>
+
+struct Renderer;
+
+// A tileset together with its GPU texture and pre-flipped raster tiles.
+// Assets are immutable; editing a tileset produces a new asset.
+struct TilesetAsset
+{
+    uint64_t key;
+    Tileset tileset;
+    RasterTiles raster;
+    unsigned int texture;
+};
+
+// Slots missing from loadedMask render as a gray ramp.
+struct PaletteAsset
+{
+    uint64_t key;
+    Palette palettes[16];
+    unsigned int loadedMask;
+    RasterPalettes raster;
+    unsigned int texture;
+};
+
+using TilesetRef = std::shared_ptr<const TilesetAsset>;
+using PaletteRef = std::shared_ptr<const PaletteAsset>;
+
+// Returns the asset with this content, creating it if no document holds one.
+// Assets are keyed by a hash of their content, not by file name, and are
+// freed together with their last reference.
+TilesetRef asset_cache_tileset(Renderer &r, const Tileset &tileset);
+PaletteRef asset_cache_palettes(Renderer &r, const Palette palettes[16], unsigned int loadedMask);
+void asset_cache_stats(int &tilesets, int &palettes);
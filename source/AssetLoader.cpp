@@ -0,0 +1,255 @@
+#include "AssetLoader.h"
+#include "ActionStack.h"
+#include "Global.h"
+#include "Importer.h"
+#include "Palette.h"
+#include "Scheduler.h"
+#include "ThreadPool.h"
+#include "Tilemap.IO.h"
+#include "Tileset.h"
+
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+enum class AssetKind : char
+{
+    Tilemap,
+    PrimaryTileset,
+    SecondaryTileset,
+    Palettes,
+    Import,
+    Count
+};
+
+struct AssetResult
+{
+    AssetKind kind;
+    unsigned int generation;
+    unsigned int documentId;
+    std::string path;
+    const char *error = nullptr;
+
+    int widthHint = 0, heightHint = 0;
+    Tilemap tilemap;
+    JournalState journal;
+    const char *journalError = nullptr;
+    TileSheet sheet;
+    Palette palettes[16];
+    unsigned int paletteMask = 0;
+
+    std::string directory;
+    std::unique_ptr<ImportResult> import;
+};
+
+static std::mutex sMutex;
+static std::vector<std::unique_ptr<AssetResult>> sFinished;
+
+// Main thread only. A newer tileset or palette request supersedes older ones
+// of the same kind that are still in flight. Tilemaps open in their own tabs,
+// so every one of them is applied.
+static unsigned int sGenerations[static_cast<int>(AssetKind::Count)];
+static int sPending = 0, sTotal = 0;
+
+static std::shared_ptr<AssetResult> asset_loader_request(AssetKind kind, const std::string &path)
+{
+    auto result = std::make_shared<AssetResult>();
+    result->kind = kind;
+    result->generation = ++sGenerations[static_cast<int>(kind)];
+    result->documentId = global.document->id;
+    result->path = path;
+    return result;
+}
+
+static void asset_loader_submit(std::shared_ptr<AssetResult> result, void (*decode)(AssetResult &))
+{
+    if (sPending == 0)
+        global.statusText.clear();
+
+    ++sPending;
+    ++sTotal;
+
+    thread_pool_submit([result, decode] {
+        decode(*result);
+
+        {
+            std::lock_guard lock(sMutex);
+            sFinished.push_back(std::make_unique<AssetResult>(std::move(*result)));
+        }
+
+        scheduler_wake();
+    });
+}
+
+void asset_loader_load_tilemap(const std::string &path)
+{
+    auto result = asset_loader_request(AssetKind::Tilemap, path);
+    result->widthHint = global.document->tilemap.width;
+    result->heightHint = global.document->tilemap.height;
+
+    asset_loader_submit(result, [](AssetResult &result) {
+        result.error = tilemap_load_file(result.tilemap, result.path, result.widthHint, result.heightHint);
+
+        // Recover unsaved edits, then index on the worker so the first query
+        // after opening is instant.
+        if (!result.error)
+        {
+            result.journalError = journal_replay(result.path, result.tilemap, result.journal);
+            tilemap_usage(result.tilemap);
+        }
+    });
+}
+
+void asset_loader_load_tileset(const std::string &path, bool secondary)
+{
+    auto kind = secondary ? AssetKind::SecondaryTileset : AssetKind::PrimaryTileset;
+
+    asset_loader_submit(asset_loader_request(kind, path), [](AssetResult &result) {
+        result.error = tileset_decode_sheet(result.path, result.sheet);
+    });
+}
+
+void asset_loader_load_palettes(const std::string &path)
+{
+    asset_loader_submit(asset_loader_request(AssetKind::Palettes, path), [](AssetResult &result) {
+        result.paletteMask = palette_load_directory(result.path, result.palettes, &result.error);
+    });
+}
+
+void asset_loader_import_image(const std::string &path, const std::string &directory)
+{
+    auto result = asset_loader_request(AssetKind::Import, path);
+    result->directory = directory;
+
+    asset_loader_submit(result, [](AssetResult &result) {
+        result.import = std::make_unique<ImportResult>();
+        result.error = import_image(result.path, *result.import);
+
+        if (!result.error)
+            result.error = import_save(*result.import, result.directory);
+
+        if (!result.error)
+        {
+            journal_base(result.import->tilemap, result.journal);
+            tilemap_usage(result.import->tilemap);
+        }
+    });
+}
+
+static void asset_loader_apply_import(AssetResult &result)
+{
+    auto &import = *result.import;
+    auto &doc = document_create_or_reuse();
+
+    doc.path = (std::filesystem::path(result.directory) / "map.bin").string();
+    doc.tilemap = std::move(import.tilemap);
+    doc.selection.clear();
+    action_stack_clear();
+    document_attach_journal(doc, result.journal);
+
+    document_set_tileset(doc, import.tileset);
+    document_set_palettes(doc, import.palettes, (1u << import.paletteCount) - 1);
+    renderer_invalidate_map(doc.view);
+
+    global.statusText = "Imported " + std::to_string(import.tileCount) + " tiles and " + std::to_string(import.paletteCount) + " palettes.";
+    if (import.lossy)
+        global.statusText += " Some tiles had too many colors and were approximated.";
+}
+
+static void asset_loader_apply_tilemap(AssetResult &result)
+{
+    auto &doc = document_create_or_reuse();
+
+    doc.path = result.path;
+    doc.tilemap = std::move(result.tilemap);
+    doc.selection.clear();
+    action_stack_clear();
+    document_attach_journal(doc, result.journal);
+    renderer_invalidate_map(doc.view);
+
+    if (result.journalError)
+        global.statusText = result.journalError;
+}
+
+static void asset_loader_apply_tileset(AssetResult &result, Document &doc)
+{
+    Tileset tileset = doc.tileset->tileset;
+    tileset_load_sheet(tileset, result.sheet, result.kind == AssetKind::SecondaryTileset);
+    document_set_tileset(doc, tileset);
+}
+
+// Slots missing from the directory keep the document's current colors.
+static void asset_loader_apply_palettes(AssetResult &result, Document &doc)
+{
+    const auto &current = *doc.palettes;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        if (!(result.paletteMask & (1 << i)))
+            memcpy(result.palettes[i], current.palettes[i], sizeof(Palette));
+    }
+
+    document_set_palettes(doc, result.palettes, current.loadedMask | result.paletteMask);
+}
+
+// Tilesets and palettes go to the document that was active when they were
+// requested, and are dropped if that tab has been closed since.
+static void asset_loader_apply(AssetResult &result)
+{
+    if (result.error)
+        global.statusText = result.error;
+
+    Document *doc = document_find(result.documentId);
+
+    switch (result.kind)
+    {
+    case AssetKind::Tilemap:
+        if (!result.error) asset_loader_apply_tilemap(result);
+        break;
+    case AssetKind::PrimaryTileset:
+    case AssetKind::SecondaryTileset:
+        if (!result.error && doc) asset_loader_apply_tileset(result, *doc);
+        break;
+    case AssetKind::Palettes:
+        if (doc) asset_loader_apply_palettes(result, *doc);
+        break;
+    case AssetKind::Import:
+        if (!result.error) asset_loader_apply_import(result);
+        break;
+    default:
+        break;
+    }
+}
+
+void asset_loader_poll(void)
+{
+    std::vector<std::unique_ptr<AssetResult>> finished;
+
+    {
+        std::lock_guard lock(sMutex);
+        finished.swap(sFinished);
+    }
+
+    for (auto &result : finished)
+    {
+        --sPending;
+
+        if (result->kind == AssetKind::Tilemap || result->generation == sGenerations[static_cast<int>(result->kind)])
+            asset_loader_apply(*result);
+    }
+
+    if (!finished.empty())
+        scheduler_invalidate();
+
+    if (sPending == 0)
+        sTotal = 0;
+}
+
+bool asset_loader_progress(int &done, int &total)
+{
+    done = sTotal - sPending;
+    total = sTotal;
+    return sPending > 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+// Decodes files on the thread pool. Finished assets are applied on the main
+// thread by asset_loader_poll(), once per frame.
+void asset_loader_load_tilemap(const std::string &path);
+void asset_loader_load_tileset(const std::string &path, bool secondary);
+void asset_loader_load_palettes(const std::string &path);
+
+// Converts an image into a tileset, tilemap and palettes, writes them to a
+// directory and opens the result.
+void asset_loader_import_image(const std::string &path, const std::string &directory);
+void asset_loader_poll(void);
+bool asset_loader_progress(int &done, int &total);
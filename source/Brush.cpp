@@ -0,0 +1,30 @@
+#include "Brush.h"
+#include "ActionStack.h"
+#include "Tilemap.h"
+
+static unsigned short change_tile_palette(unsigned short tile, unsigned char palette)
+{
+    static constexpr unsigned int Mask = 0xF << 12;
+    tile &= ~Mask;
+    tile |= (palette & 0xF) << 12;
+    return tile;
+}
+
+void brush_stamp(const Brush &brush, Tilemap &tilemap, int startX, int startY)
+{
+    for (int y = 0; y < brush.height; ++y)
+    for (int x = 0; x < brush.width; ++x)
+    {
+        if (!tilemap_contains(tilemap, startX + x, startY + y)) continue;
+
+        unsigned short tile = brush.fromTileset ? 
+            change_tile_palette(brush.selection[x + y * brush.width], brush.palette) : 
+            brush.selection[x + y * brush.width];
+
+        unsigned short old = tilemap_get(tilemap, startX + x, startY + y);
+        if (old == tile) continue;
+
+        action_stack_record((startX + x) + (startY + y) * tilemap.width, old, tile);
+        tilemap_set(tilemap, startX + x, startY + y, tile);
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+
+struct Tilemap;
+
+struct Brush
+{
+    std::vector<unsigned short> selection{0};
+    int width{1}, height{1};
+
+    bool fromTileset = true;
+
+    unsigned char palette;
+    bool xflip;
+    bool yflip;
+    bool scrollToSelected;
+};
+
+// Paints the brush with its top left corner at (startX, startY), recording
+// every changed tile in the current undo stroke.
+void brush_stamp(const Brush &brush, Tilemap &tilemap, int startX, int startY);
@@ -0,0 +1,345 @@
+#include "Compression.h"
+#include "File.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+static constexpr size_t sMaxSize = (1u << 24) - 1;
+
+static constexpr int sLzMinLength = 3, sLzMaxLength = 18;
+static constexpr int sLzWindow = 4096;
+
+static constexpr int sRleMinRun = 3, sRleMaxRun = 130, sRleMaxLiterals = 128;
+
+Compression compression_from_path(const std::string &path)
+{
+    auto ext = file_extension(path);
+
+    if (ext == ".lz") return Compression::Lz77;
+    if (ext == ".rl") return Compression::Rle;
+    return Compression::None;
+}
+
+static void write_header(std::vector<unsigned char> &out, unsigned int type, size_t size)
+{
+    out.push_back(static_cast<unsigned char>(type));
+    out.push_back(static_cast<unsigned char>(size));
+    out.push_back(static_cast<unsigned char>(size >> 8));
+    out.push_back(static_cast<unsigned char>(size >> 16));
+}
+
+static const char *read_header(const unsigned char *data, size_t size, unsigned int type, std::vector<unsigned char> &out)
+{
+    if (size < 4 || data[0] != type)
+        return "Unknown compression header.";
+
+    out.assign(data[1] | (data[2] << 8) | (data[3] << 16), 0);
+    return nullptr;
+}
+
+static void pad_to_word(std::vector<unsigned char> &out)
+{
+    while (out.size() % 4 != 0)
+        out.push_back(0);
+}
+
+// Finds the longest match at every position. Chains link earlier positions
+// whose first three bytes hash alike, newest first, so the walk stops once it
+// leaves the window or finds a match that cannot be beaten.
+static void lz77_find_matches(const unsigned char *data, size_t size, int minDistance, std::vector<uint8_t> &lengths, std::vector<uint16_t> &distances)
+{
+    static constexpr int sHashBits = 15;
+
+    std::vector<int32_t> head(1 << sHashBits, -1), prev(size, -1);
+
+    lengths.assign(size, 0);
+    distances.assign(size, 0);
+
+    for (size_t i = 0; i + sLzMinLength <= size; ++i)
+    {
+        uint32_t hash = ((data[i] << 16) | (data[i + 1] << 8) | data[i + 2]) * 2654435761u >> (32 - sHashBits);
+        int maxLength = static_cast<int>(std::min<size_t>(sLzMaxLength, size - i));
+        int best = 0;
+
+        // The previous position's match, one byte shorter, still holds here
+        // and lets most candidates be rejected on a single byte.
+        if (i > 0 && lengths[i - 1] > sLzMinLength)
+        {
+            best = lengths[i - 1] - 1;
+            distances[i] = distances[i - 1];
+        }
+
+        for (int32_t j = head[hash]; j >= 0 && best < maxLength && i - j <= sLzWindow; j = prev[j])
+        {
+            // A candidate can only beat the best if it also matches the byte
+            // right after it.
+            if (static_cast<int>(i - j) < minDistance || data[j + best] != data[i + best])
+                continue;
+
+            int length = 0;
+            while (length < maxLength && data[j + length] == data[i + length])
+                ++length;
+
+            if (length > best)
+            {
+                best = length;
+                distances[i] = static_cast<uint16_t>(i - j);
+            }
+        }
+
+        lengths[i] = static_cast<uint8_t>(best >= sLzMinLength ? best : 0);
+
+        prev[i] = head[hash];
+        head[hash] = static_cast<int32_t>(i);
+    }
+}
+
+const char *lz77_encode(const unsigned char *data, size_t size, std::vector<unsigned char> &out, bool vramSafe)
+{
+    if (size > sMaxSize)
+        return "Data is too large to compress.";
+
+    std::vector<uint8_t> lengths;
+    std::vector<uint16_t> distances;
+    lz77_find_matches(data, size, vramSafe ? 2 : 1, lengths, distances);
+
+    // Every token costs a flag bit plus one byte for a literal or two for a
+    // match, so the cheapest parse falls out of one backward pass. A match
+    // at some distance also covers every shorter length at that distance.
+    std::vector<uint32_t> cost(size + 1, 0);
+    std::vector<uint8_t> choice(size, 0);
+
+    for (size_t i = size; i-- > 0;)
+    {
+        cost[i] = cost[i + 1] + 9;
+
+        for (int length = lengths[i]; length >= sLzMinLength; --length)
+        {
+            if (cost[i + length] + 17 < cost[i])
+            {
+                cost[i] = cost[i + length] + 17;
+                choice[i] = static_cast<uint8_t>(length);
+            }
+        }
+    }
+
+    out.clear();
+    out.reserve(4 + size + size / 8 + 4);
+    write_header(out, 0x10, size);
+
+    size_t flagPos = 0;
+    int bit = 8;
+
+    for (size_t i = 0; i < size;)
+    {
+        if (bit == 8)
+        {
+            flagPos = out.size();
+            out.push_back(0);
+            bit = 0;
+        }
+
+        if (int length = choice[i])
+        {
+            int distance = distances[i] - 1;
+            out[flagPos] |= 0x80 >> bit;
+            out.push_back(static_cast<unsigned char>(((length - sLzMinLength) << 4) | (distance >> 8)));
+            out.push_back(static_cast<unsigned char>(distance));
+            i += length;
+        }
+        else
+        {
+            out.push_back(data[i++]);
+        }
+
+        ++bit;
+    }
+
+    pad_to_word(out);
+    return nullptr;
+}
+
+const char *lz77_decode(const unsigned char *data, size_t size, std::vector<unsigned char> &out)
+{
+    if (const char *error = read_header(data, size, 0x10, out))
+        return error;
+
+    size_t pos = 4, o = 0;
+
+    while (o < out.size())
+    {
+        if (pos >= size)
+            return "Compressed data is truncated.";
+
+        unsigned int flags = data[pos++];
+
+        for (int bit = 0; bit < 8 && o < out.size(); ++bit, flags <<= 1)
+        {
+            if (!(flags & 0x80))
+            {
+                if (pos >= size)
+                    return "Compressed data is truncated.";
+
+                out[o++] = data[pos++];
+                continue;
+            }
+
+            if (pos + 2 > size)
+                return "Compressed data is truncated.";
+
+            size_t length = (data[pos] >> 4) + sLzMinLength;
+            size_t distance = (((data[pos] & 0xF) << 8) | data[pos + 1]) + 1;
+            pos += 2;
+
+            if (distance > o)
+                return "Compressed data refers to bytes before the start.";
+
+            // Byte by byte, since a match may overlap what it produces.
+            for (size_t end = std::min(o + length, out.size()); o < end; ++o)
+                out[o] = out[o - distance];
+        }
+    }
+
+    return nullptr;
+}
+
+const char *rle_encode(const unsigned char *data, size_t size, std::vector<unsigned char> &out)
+{
+    if (size > sMaxSize)
+        return "Data is too large to compress.";
+
+    out.clear();
+    out.reserve(4 + size + size / sRleMaxLiterals + 4);
+    write_header(out, 0x30, size);
+
+    size_t literals = 0; // Pending literals, ending at i.
+
+    auto flush = [&](size_t end) {
+        for (size_t start = end - literals; start < end; start += sRleMaxLiterals)
+        {
+            size_t count = std::min<size_t>(sRleMaxLiterals, end - start);
+            out.push_back(static_cast<unsigned char>(count - 1));
+            out.insert(out.end(), data + start, data + start + count);
+        }
+
+        literals = 0;
+    };
+
+    for (size_t i = 0; i < size;)
+    {
+        size_t run = 1;
+        while (run < sRleMaxRun && i + run < size && data[i + run] == data[i])
+            ++run;
+
+        if (run >= sRleMinRun)
+        {
+            flush(i);
+            out.push_back(static_cast<unsigned char>(0x80 | (run - sRleMinRun)));
+            out.push_back(data[i]);
+            i += run;
+        }
+        else
+        {
+            literals += run;
+            i += run;
+        }
+    }
+
+    flush(size);
+    pad_to_word(out);
+    return nullptr;
+}
+
+const char *rle_decode(const unsigned char *data, size_t size, std::vector<unsigned char> &out)
+{
+    if (const char *error = read_header(data, size, 0x30, out))
+        return error;
+
+    size_t pos = 4, o = 0;
+
+    while (o < out.size())
+    {
+        if (pos >= size)
+            return "Compressed data is truncated.";
+
+        unsigned int flag = data[pos++];
+
+        if (flag & 0x80)
+        {
+            if (pos >= size)
+                return "Compressed data is truncated.";
+
+            size_t run = std::min<size_t>((flag & 0x7F) + sRleMinRun, out.size() - o);
+            memset(out.data() + o, data[pos++], run);
+            o += run;
+        }
+        else
+        {
+            size_t count = std::min<size_t>((flag & 0x7F) + 1, out.size() - o);
+            if (pos + count > size)
+                return "Compressed data is truncated.";
+
+            memcpy(out.data() + o, data + pos, count);
+            pos += count;
+            o += count;
+        }
+    }
+
+    return nullptr;
+}
+
+const char *compression_decode(const unsigned char *data, size_t size, std::vector<unsigned char> &out)
+{
+    if (size >= 1 && data[0] == 0x10) return lz77_decode(data, size, out);
+    if (size >= 1 && data[0] == 0x30) return rle_decode(data, size, out);
+    return "Unknown compression header.";
+}
+
+const char *compression_encode(Compression format, const unsigned char *data, size_t size, std::vector<unsigned char> &out)
+{
+    switch (format)
+    {
+    case Compression::Lz77: return lz77_encode(data, size, out);
+    case Compression::Rle: return rle_encode(data, size, out);
+    case Compression::None: break;
+    }
+
+    out.assign(data, data + size);
+    return nullptr;
+}
+
+const char *compression_load_file(const std::string &path, std::vector<unsigned char> &out)
+{
+    MappedFile file;
+    if (!file_map(file, path))
+        return "Could not open file.";
+
+    if (compression_from_path(path) == Compression::None)
+    {
+        out.assign(file.data, file.data + file.size);
+        return nullptr;
+    }
+
+    return compression_decode(file.data, file.size, out);
+}
+
+const char *compression_save_file(const std::string &path, const unsigned char *data, size_t size)
+{
+    std::vector<unsigned char> encoded;
+    Compression format = compression_from_path(path);
+
+    if (format != Compression::None)
+    {
+        if (const char *error = compression_encode(format, data, size, encoded))
+            return error;
+
+        data = encoded.data();
+        size = encoded.size();
+    }
+
+    if (!file_write_atomic(path, data, size))
+        return "Could not write file.";
+
+    return nullptr;
+}
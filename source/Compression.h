@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// The GBA BIOS formats: a 4 byte header holding the type in the low byte and
+// the decoded size in the upper 24 bits, then the stream. Encoded output is
+// padded to a multiple of 4 bytes, as the BIOS expects.
+enum class Compression : unsigned char
+{
+    None,
+    Lz77, // Type 0x10, .lz
+    Rle   // Type 0x30, .rl
+};
+
+// Picked from the last extension, e.g. map.bin.lz is LZ77.
+Compression compression_from_path(const std::string &path);
+
+// All functions return nullptr on success, otherwise a description of the error.
+// Decoding picks the format from the header.
+const char *compression_decode(const unsigned char *data, size_t size, std::vector<unsigned char> &out);
+const char *compression_encode(Compression format, const unsigned char *data, size_t size, std::vector<unsigned char> &out);
+
+// VRAM-safe streams never copy from the previous byte, because VRAM is
+// written 16 bits at a time. The match finder walks hash chains over the
+// whole 4 KB window and picks the cheapest parse, not the greedy one.
+const char *lz77_encode(const unsigned char *data, size_t size, std::vector<unsigned char> &out, bool vramSafe = true);
+const char *lz77_decode(const unsigned char *data, size_t size, std::vector<unsigned char> &out);
+const char *rle_encode(const unsigned char *data, size_t size, std::vector<unsigned char> &out);
+const char *rle_decode(const unsigned char *data, size_t size, std::vector<unsigned char> &out);
+
+// Read or write a whole file, decoding or encoding it when its extension
+// names a compression format. Writes are atomic.
+const char *compression_load_file(const std::string &path, std::vector<unsigned char> &out);
+const char *compression_save_file(const std::string &path, const unsigned char *data, size_t size);
@@ -0,0 +1,167 @@
+#include "Document.h"
+#include "Global.h"
+#include "Scheduler.h"
+
+#include <algorithm>
+#include <filesystem>
+
+static unsigned int sNextId = 1;
+
+Document &document_create(void)
+{
+    auto doc = std::make_unique<Document>();
+    doc->id = sNextId++;
+    tilemap_create(doc->tilemap, 32, 32);
+
+    if (global.document)
+    {
+        doc->tileset = global.document->tileset;
+        doc->palettes = global.document->palettes;
+    }
+    else
+    {
+        static const Palette sNoPalettes[16] = {};
+        doc->tileset = asset_cache_tileset(global.renderer, Tileset());
+        doc->palettes = asset_cache_palettes(global.renderer, sNoPalettes, 0);
+    }
+
+    global.documents.push_back(std::move(doc));
+    document_activate(*global.documents.back());
+    return *global.documents.back();
+}
+
+Document &document_create_or_reuse(void)
+{
+    auto *doc = global.document;
+
+    if (doc && doc->path.empty() && doc->history.actions.empty() && doc->history.stroke.empty())
+        return *doc;
+
+    return document_create();
+}
+
+Document *document_find(unsigned int id)
+{
+    for (auto &doc : global.documents)
+    {
+        if (doc->id == id)
+            return doc.get();
+    }
+
+    return nullptr;
+}
+
+void document_activate(Document &doc)
+{
+    global.document = &doc;
+    doc.view.changed = true;
+    scheduler_invalidate();
+}
+
+// The last document is never closed, the editor always shows one.
+void document_close(Document &doc)
+{
+    auto &docs = global.documents;
+
+    if (docs.size() < 2)
+        return;
+
+    auto it = std::find_if(docs.begin(), docs.end(), [&](const auto &d) { return d.get() == &doc; });
+    if (it == docs.end())
+        return;
+
+    renderer_release_map(doc.view);
+    journal_close(doc.journal);
+
+    bool active = global.document == &doc;
+    it = docs.erase(it);
+
+    if (active)
+        document_activate(it != docs.end() ? **it : *docs.back());
+}
+
+// Releases the cached assets while the GL context is still current.
+void document_close_all(void)
+{
+    for (auto &doc : global.documents)
+    {
+        renderer_release_map(doc->view);
+        journal_close(doc->journal);
+    }
+
+    global.document = nullptr;
+    global.documents.clear();
+}
+
+std::string document_title(const Document &doc)
+{
+    if (doc.path.empty())
+        return "Untitled";
+
+    return std::filesystem::path(doc.path).filename().string();
+}
+
+void document_attach_journal(Document &doc, const JournalState &state)
+{
+    journal_close(doc.journal);
+    doc.unsaved = state.records > 0;
+
+    if (state.records > 0)
+    {
+        if (!state.changes.empty())
+            action_stack_add_undo_action(state.changes.data(), state.changes.size());
+
+        global.statusText = "Recovered " + std::to_string(state.records) + " unsaved edits from the journal.";
+    }
+
+    for (auto &other : global.documents)
+    {
+        if (other.get() != &doc && other->journal.path == journal_path(doc.path))
+            return;
+    }
+
+    journal_attach(doc.journal, doc.path, state);
+}
+
+void document_compact_journal(Document &doc, const std::string &path)
+{
+    doc.unsaved = false;
+
+    for (auto &other : global.documents)
+    {
+        if (other.get() != &doc && other->journal.path == journal_path(path))
+        {
+            journal_close(other->journal);
+            global.statusText = document_title(*other) + " is open in another tab too, which no longer autosaves.";
+        }
+    }
+
+    if (const char *error = journal_compact(doc.journal, path, doc.tilemap))
+        global.statusText = error;
+}
+
+void document_sync_journals(void)
+{
+    for (auto &doc : global.documents)
+    {
+        journal_sync(doc->journal, false);
+
+        // The main loop sleeps while the editor is idle, which would leave
+        // the last edits unflushed until the next input.
+        double due = journal_sync_due(doc->journal);
+        if (due >= 0.0)
+            scheduler_wake_after(due);
+    }
+}
+
+void document_set_tileset(Document &doc, const Tileset &tileset)
+{
+    doc.tileset = asset_cache_tileset(global.renderer, tileset);
+    scheduler_invalidate();
+}
+
+void document_set_palettes(Document &doc, const Palette palettes[16], unsigned int loadedMask)
+{
+    doc.palettes = asset_cache_palettes(global.renderer, palettes, loadedMask);
+    scheduler_invalidate();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ActionStack.h"
+#include "AssetCache.h"
+#include "Journal.h"
+#include "Renderer.h"
+#include "Tilemap.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One open tilemap, shown as a tab. Each document has its own undo history,
+// edit journal and chunk renders, while tilesets and palettes come from the
+// asset cache, so documents with the same assets share them.
+struct Document
+{
+    unsigned int id;
+    std::string path;
+    Tilemap tilemap;
+    ActionHistory history;
+    Journal journal;
+    MapView view;
+
+    // Cells picked by the Find Tile window, as x + y * width.
+    std::vector<uint32_t> selection;
+
+    // The map has changed since it was loaded or last saved.
+    bool unsaved = false;
+
+    TilesetRef tileset;
+    PaletteRef palettes;
+};
+
+// Adds an empty document that starts out with the active document's tileset
+// and palettes, and makes it active.
+Document &document_create(void);
+
+// Reuses the active document if it is still empty and untouched, so that
+// opening a file right after start-up does not leave a blank tab behind.
+Document &document_create_or_reuse(void);
+
+Document *document_find(unsigned int id);
+void document_activate(Document &doc);
+void document_close(Document &doc);
+void document_close_all(void);
+std::string document_title(const Document &doc);
+
+// Journals further edits of the active document doc, continuing what
+// journal_replay() found for its path. Recovered edits become one undo
+// action. A map whose journal another tab already writes is not journaled
+// twice.
+void document_attach_journal(Document &doc, const JournalState &state);
+
+// doc was just saved to path. Its journal starts over there, taking the
+// path's journal from any other tab, which then stops autosaving.
+void document_compact_journal(Document &doc, const std::string &path);
+
+// Flushes journals whose sync interval has passed. Called once per frame.
+void document_sync_journals(void);
+
+// Replace the document's assets through the cache. Other documents keep the
+// assets they had.
+void document_set_tileset(Document &doc, const Tileset &tileset);
+void document_set_palettes(Document &doc, const Palette palettes[16], unsigned int loadedMask);
@@ -0,0 +1,310 @@
+#include "File.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    file_unmap(*this);
+}
+
+AppendFile::~AppendFile()
+{
+    file_close(*this);
+}
+
+#ifdef _WIN32
+
+bool file_map(MappedFile &file, const std::string &path)
+{
+    file_unmap(file);
+
+    HANDLE handle = CreateFileW(std::filesystem::path(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size))
+    {
+        CloseHandle(handle);
+        return false;
+    }
+
+    file.handle = handle;
+    file.size = static_cast<size_t>(size.QuadPart);
+
+    // Empty files cannot be mapped, but are still valid.
+    if (file.size == 0)
+        return true;
+
+    HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+    if (!data)
+    {
+        if (mapping) CloseHandle(mapping);
+        file_unmap(file);
+        return false;
+    }
+
+    file.mapping = mapping;
+    file.data = static_cast<const unsigned char *>(data);
+    return true;
+}
+
+void file_unmap(MappedFile &file)
+{
+    if (file.data) UnmapViewOfFile(file.data);
+    if (file.mapping) CloseHandle(file.mapping);
+    if (file.handle) CloseHandle(file.handle);
+
+    file.data = nullptr;
+    file.size = 0;
+    file.mapping = nullptr;
+    file.handle = nullptr;
+}
+
+// Creates path, which must not exist yet; exists tells whether it did.
+static bool write_and_flush(const std::string &path, const void *data, size_t size, bool &exists)
+{
+    HANDLE handle = CreateFileW(std::filesystem::path(path).c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+    exists = handle == INVALID_HANDLE_VALUE && GetLastError() == ERROR_FILE_EXISTS;
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    DWORD written = 0;
+    bool ok = WriteFile(handle, data, static_cast<DWORD>(size), &written, nullptr) && written == size;
+    ok = ok && FlushFileBuffers(handle);
+
+    CloseHandle(handle);
+    return ok;
+}
+
+static bool replace_file(const std::string &from, const std::string &to)
+{
+    return MoveFileExW(std::filesystem::path(from).c_str(), std::filesystem::path(to).c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+}
+
+bool file_open_append(AppendFile &file, const std::string &path, uint64_t keep)
+{
+    file_close(file);
+
+    HANDLE handle = CreateFileW(std::filesystem::path(path).c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER offset;
+    offset.QuadPart = static_cast<LONGLONG>(keep);
+
+    if (!SetFilePointerEx(handle, offset, nullptr, FILE_BEGIN) || !SetEndOfFile(handle))
+    {
+        CloseHandle(handle);
+        return false;
+    }
+
+    file.handle = reinterpret_cast<intptr_t>(handle);
+    return true;
+}
+
+bool file_append(AppendFile &file, const void *data, size_t size)
+{
+    DWORD written = 0;
+    return file.handle != -1 && WriteFile(reinterpret_cast<HANDLE>(file.handle), data, static_cast<DWORD>(size), &written, nullptr) && written == size;
+}
+
+bool file_sync(AppendFile &file)
+{
+    return file.handle != -1 && FlushFileBuffers(reinterpret_cast<HANDLE>(file.handle));
+}
+
+void file_close(AppendFile &file)
+{
+    if (file.handle != -1) CloseHandle(reinterpret_cast<HANDLE>(file.handle));
+    file.handle = -1;
+}
+
+#else
+
+bool file_map(MappedFile &file, const std::string &path)
+{
+    file_unmap(file);
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    file.size = static_cast<size_t>(st.st_size);
+
+    if (file.size > 0)
+    {
+        void *data = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            file.size = 0;
+            return false;
+        }
+
+        file.mapping = data;
+        file.data = static_cast<const unsigned char *>(data);
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+    return true;
+}
+
+void file_unmap(MappedFile &file)
+{
+    if (file.mapping) munmap(file.mapping, file.size);
+
+    file.data = nullptr;
+    file.size = 0;
+    file.mapping = nullptr;
+    file.handle = nullptr;
+}
+
+// Creates path, which must not exist yet; exists tells whether it did.
+static bool write_and_flush(const std::string &path, const void *data, size_t size, bool &exists)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    exists = fd < 0 && errno == EEXIST;
+    if (fd < 0)
+        return false;
+
+    auto *bytes = static_cast<const unsigned char *>(data);
+    bool ok = true;
+
+    while (ok && size > 0)
+    {
+        ssize_t written = write(fd, bytes, size);
+        ok = written > 0;
+        if (ok) { bytes += written; size -= written; }
+    }
+
+    ok = ok && fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+static bool replace_file(const std::string &from, const std::string &to)
+{
+    if (rename(from.c_str(), to.c_str()) != 0)
+        return false;
+
+    // Persist the rename itself.
+    auto dir = std::filesystem::path(to).parent_path();
+    int fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+
+    return true;
+}
+
+bool file_open_append(AppendFile &file, const std::string &path, uint64_t keep)
+{
+    file_close(file);
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0)
+        return false;
+
+    if (ftruncate(fd, static_cast<off_t>(keep)) != 0 || lseek(fd, 0, SEEK_END) < 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    file.handle = fd;
+    return true;
+}
+
+bool file_append(AppendFile &file, const void *data, size_t size)
+{
+    auto *bytes = static_cast<const unsigned char *>(data);
+
+    while (file.handle != -1 && size > 0)
+    {
+        ssize_t written = write(static_cast<int>(file.handle), bytes, size);
+        if (written <= 0) return false;
+        bytes += written;
+        size -= written;
+    }
+
+    return file.handle != -1;
+}
+
+bool file_sync(AppendFile &file)
+{
+    return file.handle != -1 && fsync(static_cast<int>(file.handle)) == 0;
+}
+
+void file_close(AppendFile &file)
+{
+    if (file.handle != -1) close(static_cast<int>(file.handle));
+    file.handle = -1;
+}
+
+#endif
+
+std::string file_extension(const std::string &path)
+{
+    std::string ext = std::filesystem::path(path).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext;
+}
+
+// Writes to a sibling temporary file, flushes it to disk and renames it over
+// the destination, so a crash leaves either the old or the new file. The
+// temporary name is random and created exclusively, so concurrent writers of
+// the same file and files that happen to have that name are left alone.
+bool file_write_atomic(const std::string &path, const void *data, size_t size)
+{
+    thread_local std::mt19937 rng{ std::random_device{}() };
+
+    for (int attempt = 0; attempt < 16; ++attempt)
+    {
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), ".%08x.tmp", static_cast<unsigned int>(rng()));
+        std::string temp = path + suffix;
+
+        bool exists = false;
+        if (write_and_flush(temp, data, size, exists) && replace_file(temp, path))
+            return true;
+
+        if (!exists)
+        {
+            std::error_code ec;
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+
+    return false;
+}
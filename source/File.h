@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a whole file, memory mapped where possible.
+struct MappedFile
+{
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+
+    void *mapping = nullptr;
+    void *handle = nullptr;
+
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+};
+
+bool file_map(MappedFile &file, const std::string &path);
+void file_unmap(MappedFile &file);
+bool file_write_atomic(const std::string &path, const void *data, size_t size);
+
+// The extension of path including the dot, in lower case, e.g. ".png".
+std::string file_extension(const std::string &path);
+
+// Write-only file that only grows, for logs that have to survive a crash.
+// Appends reach the OS right away; file_sync() also flushes them to disk.
+struct AppendFile
+{
+    intptr_t handle = -1;
+
+    AppendFile() = default;
+    AppendFile(const AppendFile &) = delete;
+    AppendFile &operator=(const AppendFile &) = delete;
+    ~AppendFile();
+};
+
+// Opens or creates path, cut down to its first keep bytes.
+bool file_open_append(AppendFile &file, const std::string &path, uint64_t keep);
+bool file_append(AppendFile &file, const void *data, size_t size);
+bool file_sync(AppendFile &file);
+void file_close(AppendFile &file);
@@ -1,21 +1,12 @@
 #pragma once
 
+#include <memory>
 #include <string>
+#include <vector>
+#include "Brush.h"
+#include "Document.h"
 #include "Renderer.h"
 
-struct Brush
-{
-    std::vector<unsigned short> selection{0};
-    int width{1}, height{1};
-
-    bool fromTileset = true;
-
-    unsigned char palette;
-    bool xflip;
-    bool yflip;
-    bool scrollToSelected;
-};
-
 struct Global
 {
     double dpiScale, zoomScale = 1.0f;
@@ -23,9 +14,17 @@ struct Global
     Renderer renderer;
 
     bool drawScreenBounds = false;
+    bool showProfiler = false;
+    bool showTileUsage = false;
+    bool showFindTile = false;
+    int frameCap = 60;
+
+    std::string statusText;
 
-    std::string tilemapPath;
-    unsigned short tilemap[32 * 32];
+    // Open tabs, in display order. The active one is never null once the
+    // editor has started.
+    std::vector<std::unique_ptr<Document>> documents;
+    Document *document = nullptr;
 };
 
-extern Global global;
\ No newline at end of file
+extern Global global;
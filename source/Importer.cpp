@@ -0,0 +1,358 @@
+#include "Importer.h"
+#include "Palette.h"
+#include "ThreadPool.h"
+#include "TileOptimizer.h"
+#include "Tilemap.IO.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Colors are matched at GBA precision, BGR555.
+using Color15 = unsigned short;
+
+static constexpr int sMaxColors = 15;
+
+struct ImportTile
+{
+    Color15 pixels[64];
+
+    // Distinct colors other than the backdrop, sorted, at most sMaxColors.
+    std::vector<Color15> colors;
+    int palette = -1;
+
+    unsigned char indices[64];
+    PackedTile canonical;
+    unsigned short flips;
+};
+
+static Color15 to_color15(const unsigned char *rgb)
+{
+    return (rgb[0] >> 3) | ((rgb[1] >> 3) << 5) | ((rgb[2] >> 3) << 10);
+}
+
+static Color to_color(Color15 color)
+{
+    return {
+        static_cast<unsigned char>(((color >> 0) & 0x1F) * 255 / 31),
+        static_cast<unsigned char>(((color >> 5) & 0x1F) * 255 / 31),
+        static_cast<unsigned char>(((color >> 10) & 0x1F) * 255 / 31)
+    };
+}
+
+static int color_distance(Color15 a, Color15 b)
+{
+    int dr = (a & 0x1F) - (b & 0x1F);
+    int dg = ((a >> 5) & 0x1F) - ((b >> 5) & 0x1F);
+    int db = ((a >> 10) & 0x1F) - ((b >> 10) & 0x1F);
+    return dr * dr + dg * dg + db * db;
+}
+
+// Collects the distinct colors of a tile, keeping the most frequent ones
+// when there are more than a palette can hold. Returns false in that case.
+static bool collect_colors(ImportTile &tile, Color15 backdrop)
+{
+    Color15 sorted[64];
+    std::copy(std::begin(tile.pixels), std::end(tile.pixels), sorted);
+    std::sort(std::begin(sorted), std::end(sorted));
+
+    std::pair<int, Color15> runs[64];
+    int count = 0;
+
+    for (int i = 0; i < 64;)
+    {
+        int j = i;
+        while (j < 64 && sorted[j] == sorted[i]) ++j;
+
+        if (sorted[i] != backdrop)
+            runs[count++] = { -(j - i), sorted[i] };
+
+        i = j;
+    }
+
+    bool exact = count <= sMaxColors;
+
+    if (!exact)
+    {
+        std::partial_sort(runs, runs + sMaxColors, runs + count);
+        count = sMaxColors;
+    }
+
+    tile.colors.resize(count);
+    for (int i = 0; i < count; ++i)
+        tile.colors[i] = runs[i].second;
+
+    std::sort(tile.colors.begin(), tile.colors.end());
+    return exact;
+}
+
+// Greedy packing: tiles with the most colors go first, then each tile reuses
+// a palette that already has its colors, else the palette that needs the
+// fewest additions, else a new palette. Returns false if some tile could not
+// be placed; those are left at -1.
+static bool assign_palettes(std::vector<ImportTile> &tiles, std::vector<std::vector<Color15>> &palettes)
+{
+    std::vector<int> order(tiles.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int>(i);
+
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return tiles[a].colors.size() > tiles[b].colors.size();
+    });
+
+    std::map<std::vector<Color15>, int> known;
+    bool exact = true;
+
+    for (int i : order)
+    {
+        auto &tile = tiles[i];
+
+        if (auto it = known.find(tile.colors); it != known.end())
+        {
+            tile.palette = it->second;
+            continue;
+        }
+
+        int best = -1;
+        size_t bestSize = 0;
+
+        for (size_t p = 0; p < palettes.size(); ++p)
+        {
+            std::vector<Color15> merged;
+            std::set_union(palettes[p].begin(), palettes[p].end(), tile.colors.begin(), tile.colors.end(), std::back_inserter(merged));
+
+            if (merged.size() <= sMaxColors && (best < 0 || merged.size() - palettes[p].size() < bestSize))
+            {
+                best = static_cast<int>(p);
+                bestSize = merged.size() - palettes[p].size();
+
+                if (bestSize == 0)
+                    break;
+            }
+        }
+
+        if (best < 0 && palettes.size() < 16)
+        {
+            best = static_cast<int>(palettes.size());
+            palettes.emplace_back();
+        }
+
+        if (best < 0)
+        {
+            exact = false;
+            continue;
+        }
+
+        std::vector<Color15> merged;
+        std::set_union(palettes[best].begin(), palettes[best].end(), tile.colors.begin(), tile.colors.end(), std::back_inserter(merged));
+        palettes[best] = std::move(merged);
+
+        tile.palette = best;
+        known.emplace(tile.colors, best);
+    }
+
+    return exact;
+}
+
+static int nearest_color(const Color15 *colors, int count, Color15 color, int &distance)
+{
+    int best = 0;
+    distance = color_distance(colors[0], color);
+
+    for (int i = 1; i < count && distance > 0; ++i)
+    {
+        int d = color_distance(colors[i], color);
+        if (d < distance)
+        {
+            best = i;
+            distance = d;
+        }
+    }
+
+    return best;
+}
+
+const char *import_image_pixels(const unsigned char *rgb, int width, int height, ImportResult &out)
+{
+    if (width <= 0 || height <= 0 || width % 8 != 0 || height % 8 != 0)
+        return "Image size must be a multiple of 8 pixels.";
+
+    int tilesX = width / 8, tilesY = height / 8;
+    std::vector<ImportTile> tiles(static_cast<size_t>(tilesX) * tilesY);
+
+    thread_pool_parallel_for(tiles.size(), [&](size_t i) {
+        int tx = static_cast<int>(i % tilesX) * 8, ty = static_cast<int>(i / tilesX) * 8;
+
+        for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 8; ++x)
+            tiles[i].pixels[x + y * 8] = to_color15(rgb + ((ty + y) * static_cast<size_t>(width) + tx + x) * 3);
+    });
+
+    std::vector<unsigned int> histogram(1 << 15);
+    for (const auto &tile : tiles)
+    {
+        for (Color15 pixel : tile.pixels)
+            ++histogram[pixel];
+    }
+
+    Color15 backdrop = static_cast<Color15>(std::max_element(histogram.begin(), histogram.end()) - histogram.begin());
+
+    std::atomic<bool> truncated = false;
+
+    thread_pool_parallel_for(tiles.size(), [&](size_t i) {
+        if (!collect_colors(tiles[i], backdrop))
+            truncated = true;
+    });
+
+    std::vector<std::vector<Color15>> palettes;
+    out.lossy = !assign_palettes(tiles, palettes) || truncated;
+
+    // Full palettes with the backdrop in slot 0, as the tiles index them.
+    std::vector<std::array<Color15, 16>> slots(palettes.size());
+    for (size_t p = 0; p < palettes.size(); ++p)
+    {
+        slots[p].fill(backdrop);
+        std::copy(palettes[p].begin(), palettes[p].end(), slots[p].begin() + 1);
+    }
+
+    thread_pool_parallel_for(tiles.size(), [&](size_t i) {
+        auto &tile = tiles[i];
+
+        // Tiles that fit no palette take the one that reproduces them best.
+        if (tile.palette < 0)
+        {
+            int bestError = -1;
+
+            for (size_t p = 0; p < slots.size(); ++p)
+            {
+                int error = 0, distance;
+                for (Color15 pixel : tile.pixels)
+                {
+                    nearest_color(slots[p].data(), static_cast<int>(palettes[p].size()) + 1, pixel, distance);
+                    error += distance;
+                }
+
+                if (bestError < 0 || error < bestError)
+                {
+                    tile.palette = static_cast<int>(p);
+                    bestError = error;
+                }
+            }
+        }
+
+        const auto &slot = slots[tile.palette];
+        int count = static_cast<int>(palettes[tile.palette].size()) + 1, distance;
+
+        for (int p = 0; p < 64; ++p)
+            tile.indices[p] = static_cast<unsigned char>(nearest_color(slot.data(), count, tile.pixels[p], distance));
+
+        tile.canonical = tile_optimizer_canonicalize(tile_optimizer_pack(tile.indices), tile.flips);
+    });
+
+    // Tile 0 stays blank so that empty map entries show the backdrop.
+    std::unordered_map<PackedTile, unsigned short, PackedTileHash> seen;
+    seen.reserve(Tileset::TileCount);
+    seen.emplace(PackedTile{}, 0);
+
+    out.tileset = Tileset{};
+    out.tileCount = 1;
+
+    std::vector<unsigned short> entries(tiles.size());
+
+    for (size_t i = 0; i < tiles.size(); ++i)
+    {
+        auto &tile = tiles[i];
+        auto [it, inserted] = seen.try_emplace(tile.canonical, static_cast<unsigned short>(out.tileCount | tile.flips));
+
+        if (inserted)
+        {
+            if (out.tileCount == Tileset::TileCount)
+                return "Image needs more than 1024 unique tiles.";
+
+            tileset_pack_tile(tile.indices, out.tileset.tiles[out.tileCount++]);
+        }
+
+        unsigned short first = it->second;
+        entries[i] = (first & Mask::Index) | ((first ^ tile.flips) & (Mask::FlipX | Mask::FlipY)) | (tile.palette << 12);
+    }
+
+    tilemap_create(out.tilemap, tilesX, tilesY);
+    for (size_t i = 0; i < entries.size(); ++i)
+        tilemap_set(out.tilemap, static_cast<int>(i % tilesX), static_cast<int>(i / tilesX), entries[i]);
+
+    out.paletteCount = static_cast<int>(palettes.size());
+    for (int p = 0; p < 16; ++p)
+    {
+        for (int c = 0; c < 16; ++c)
+            out.palettes[p][c] = p < out.paletteCount ? to_color(slots[p][c]) : Color{};
+    }
+
+    // The sheets carry palette 0 so they preview sensibly in other tools.
+    std::vector<unsigned char> plte;
+    for (const auto &color : out.palettes[0])
+        plte.insert(plte.end(), { color.r, color.g, color.b });
+
+    for (int sheet = 0; sheet < 2; ++sheet)
+    {
+        out.tileset.sheetLoaded[sheet] = sheet == 0 || out.tileCount > Tileset::SheetTiles;
+        out.tileset.sheetPalettes[sheet] = plte;
+    }
+
+    return nullptr;
+}
+
+const char *import_image(const std::string &path, ImportResult &out)
+{
+    int width, height, channels;
+    std::unique_ptr<unsigned char, decltype(&stbi_image_free)> rgb(stbi_load(path.c_str(), &width, &height, &channels, 3), &stbi_image_free);
+
+    if (!rgb)
+        return "Could not load image.";
+
+    return import_image_pixels(rgb.get(), width, height, out);
+}
+
+const char *import_save(const ImportResult &result, const std::string &directory)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+
+    fs::path dir(directory);
+    static const char *sSheetNames[2] = { "tiles.png", "tiles2.png" };
+
+    for (int sheet = 0; sheet < 2; ++sheet)
+    {
+        if (!result.tileset.sheetLoaded[sheet])
+            continue;
+
+        auto tiles = std::make_unique<TileSheet>();
+        tileset_store_sheet(result.tileset, sheet == 1, *tiles);
+
+        if (const char *error = tileset_save_sheet((dir / sSheetNames[sheet]).string(), *tiles))
+            return error;
+    }
+
+    if (const char *error = tilemap_save_file(result.tilemap, (dir / "map.bin").string()))
+        return error;
+
+    for (int p = 0; p < result.paletteCount; ++p)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "%02d.pal", p);
+
+        if (const char *error = palette_save_file((dir / name).string(), result.palettes[p]))
+            return error;
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Tilemap.h"
+#include "Tileset.h"
+#include "Utils.h"
+
+#include <string>
+
+struct ImportResult
+{
+    Tilemap tilemap;
+    Tileset tileset;
+    Palette palettes[16]{};
+    int paletteCount = 0;
+    int tileCount = 0;
+
+    // Set when some tiles needed more colors than a palette could give them
+    // and were matched to the nearest available colors instead.
+    bool lossy = false;
+};
+
+// Converts a truecolor image, a multiple of 8 pixels in both directions, into
+// 4bpp tiles, a tilemap and up to 16 palettes. Color 0 of every palette is
+// the most common color of the image, so it can serve as the backdrop.
+// All functions return nullptr on success, otherwise a description of the error.
+const char *import_image_pixels(const unsigned char *rgb, int width, int height, ImportResult &out);
+const char *import_image(const std::string &path, ImportResult &out);
+
+// Writes tiles.png (plus tiles2.png once the secondary sheet is used), map.bin
+// and NN.pal into a directory, in the formats the editor loads.
+const char *import_save(const ImportResult &result, const std::string &directory);
@@ -0,0 +1,504 @@
+#include "Journal.h"
+#include "Tilemap.IO.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+
+// File layout, little endian:
+//   "PXJL", u32 version, u32 width, u32 height, u64 journal_hash() of the
+//   saved map,
+//   then records of u8 kind, u32 payload length, u32 payload checksum and
+//   the payload. An edit holds a varint delta count, then per delta the
+//   zigzag varint distance to the previous cell and u16 old and new entries,
+//   so a brush stroke costs about 5 bytes per tile. A snapshot holds u32
+//   width, u32 height and every entry as u16.
+static constexpr char sMagic[4] = { 'P', 'X', 'J', 'L' };
+static constexpr uint32_t sVersion = 1;
+static constexpr size_t sHeaderSize = sizeof(sMagic) + 4 + 4 + 4 + 8;
+
+static constexpr auto sSyncInterval = std::chrono::seconds(2);
+
+enum class RecordKind : unsigned char
+{
+    Edit = 1,
+    Snapshot = 2
+};
+
+struct JournalWriter
+{
+    std::vector<unsigned char> &data;
+
+    void u8(unsigned int v) { data.push_back(static_cast<unsigned char>(v)); }
+    void u16(unsigned int v) { u8(v); u8(v >> 8); }
+    void u32(uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); }
+    void u64(uint64_t v) { u32(static_cast<uint32_t>(v)); u32(static_cast<uint32_t>(v >> 32)); }
+
+    void varint(uint64_t v)
+    {
+        for (; v >= 0x80; v >>= 7)
+            u8((v & 0x7F) | 0x80);
+
+        u8(static_cast<unsigned int>(v));
+    }
+
+    void patch32(size_t at, uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            data[at + i] = static_cast<unsigned char>(v >> (i * 8));
+    }
+};
+
+struct JournalReader
+{
+    const unsigned char *data, *end;
+    bool failed = false;
+
+    bool need(size_t n)
+    {
+        if (static_cast<size_t>(end - data) < n) failed = true;
+        return !failed;
+    }
+
+    unsigned int u8(void) { return need(1) ? *data++ : 0; }
+    unsigned int u16(void) { unsigned int lo = u8(); return lo | (u8() << 8); }
+    uint32_t u32(void) { uint32_t lo = u16(); return lo | (static_cast<uint32_t>(u16()) << 16); }
+    uint64_t u64(void) { uint64_t lo = u32(); return lo | (static_cast<uint64_t>(u32()) << 32); }
+
+    uint64_t varint(void)
+    {
+        uint64_t v = 0;
+
+        for (int shift = 0; shift < 64 && !failed; shift += 7)
+        {
+            unsigned int b = u8();
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+
+        failed = true;
+        return 0;
+    }
+};
+
+// FNV-1a
+static uint32_t journal_checksum(const unsigned char *data, size_t size)
+{
+    uint32_t hash = 0x811C9DC5u;
+
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * 0x01000193u;
+
+    return hash;
+}
+
+std::string journal_path(const std::string &mapPath)
+{
+    return mapPath + ".journal";
+}
+
+// FNV-1a over the bytes tilemap_write() produces, screenblock by
+// screenblock. The file does not store the map's shape, so a map that is
+// reloaded with another width and height still hashes the same.
+uint64_t journal_hash(const Tilemap &tilemap)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for (const auto &chunk : tilemap.chunks)
+    {
+        for (int i = 0; i < TilemapChunk::Area; ++i)
+        {
+            unsigned int v = chunk ? chunk->tiles[i] : 0;
+            hash = (hash ^ (v & 0xFF)) * 0x100000001B3ull;
+            hash = (hash ^ (v >> 8)) * 0x100000001B3ull;
+        }
+    }
+
+    return hash;
+}
+
+void journal_base(const Tilemap &tilemap, JournalState &state)
+{
+    state = JournalState();
+    state.width = tilemap.width;
+    state.height = tilemap.height;
+    state.hash = journal_hash(tilemap);
+}
+
+// Keeps the first old and the last new value of every cell, like a stroke.
+static void journal_track(JournalState &state, std::unordered_map<uint32_t, size_t> &slots, uint32_t cell, uint16_t oldTile, uint16_t newTile)
+{
+    if (state.resized)
+        return;
+
+    auto [it, inserted] = slots.try_emplace(cell, state.changes.size());
+
+    if (inserted)
+        state.changes.push_back({ cell, oldTile, newTile });
+    else
+        state.changes[it->second].newTile = newTile;
+}
+
+// A record is applied completely or not at all.
+static bool journal_apply_edit(JournalReader &in, Tilemap &tilemap, JournalState &state, std::unordered_map<uint32_t, size_t> &slots)
+{
+    uint64_t count = in.varint();
+    uint64_t cells = static_cast<uint64_t>(tilemap.width) * tilemap.height;
+
+    // Every delta takes at least five bytes, which bounds the allocation.
+    if (count > static_cast<uint64_t>(in.end - in.data) / 5)
+        return false;
+
+    std::vector<TileDelta> deltas(count);
+    int64_t cell = 0;
+
+    for (auto &delta : deltas)
+    {
+        uint64_t zigzag = in.varint();
+        cell += static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+
+        if (cell < 0 || static_cast<uint64_t>(cell) >= cells)
+            return false;
+
+        delta.index = static_cast<unsigned int>(cell);
+        delta.oldTile = static_cast<unsigned short>(in.u16());
+        delta.newTile = static_cast<unsigned short>(in.u16());
+    }
+
+    if (in.failed)
+        return false;
+
+    for (size_t i = 0; i < deltas.size(); ++i)
+    {
+        const auto &delta = deltas[i];
+        int x = delta.index % tilemap.width, y = delta.index / tilemap.width;
+
+        if (tilemap_get(tilemap, x, y) != delta.oldTile)
+        {
+            while (i-- > 0)
+                tilemap_set(tilemap, deltas[i].index % tilemap.width, deltas[i].index / tilemap.width, deltas[i].oldTile);
+
+            return false;
+        }
+
+        tilemap_set(tilemap, x, y, delta.newTile);
+    }
+
+    for (const auto &delta : deltas)
+        journal_track(state, slots, delta.index, delta.oldTile, delta.newTile);
+
+    return true;
+}
+
+static bool journal_apply_snapshot(JournalReader &in, Tilemap &tilemap, JournalState &state)
+{
+    uint32_t width = in.u32(), height = in.u32();
+
+    if (in.failed || width == 0 || height == 0 || static_cast<uint64_t>(width) * height > static_cast<uint64_t>(in.end - in.data) / 2)
+        return false;
+
+    tilemap_create(tilemap, static_cast<int>(width), static_cast<int>(height));
+
+    for (uint32_t y = 0; y < height; ++y)
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        unsigned int entry = in.u16();
+        if (entry) tilemap_set(tilemap, x, y, static_cast<unsigned short>(entry));
+    }
+
+    state.resized = true;
+    state.changes.clear();
+    return true;
+}
+
+// Keeps a journal that cannot be continued under the first free
+// "<journal>.N", so that the next edit does not overwrite what it holds.
+static bool journal_set_aside(const std::string &path, bool copy)
+{
+    std::error_code ec;
+
+    for (int i = 1; i < 1000; ++i)
+    {
+        std::string target = path + "." + std::to_string(i);
+        if (std::filesystem::exists(target, ec))
+            continue;
+
+        if (copy) std::filesystem::copy_file(path, target, ec);
+        else std::filesystem::rename(path, target, ec);
+
+        return !ec;
+    }
+
+    return false;
+}
+
+const char *journal_replay(const std::string &mapPath, Tilemap &tilemap, JournalState &state)
+{
+    journal_base(tilemap, state);
+
+    std::string path = journal_path(mapPath);
+
+    MappedFile file;
+    if (!file_map(file, path))
+        return nullptr;
+
+    // A crash during the very first append leaves less than a header and
+    // nothing to recover.
+    if (file.size < sHeaderSize)
+        return nullptr;
+
+    JournalReader in{ file.data, file.data + file.size };
+
+    bool valid = memcmp(in.data, sMagic, sizeof(sMagic)) == 0;
+    in.data += sizeof(sMagic);
+
+    valid = in.u32() == sVersion && valid;
+    int width = static_cast<int>(in.u32()), height = static_cast<int>(in.u32());
+    valid = in.u64() == state.hash && valid;
+
+    // The map was reloaded in the shape its size suggests, which need not
+    // be the shape it was edited in.
+    if (valid && (width != tilemap.width || height != tilemap.height))
+    {
+        auto bytes = tilemap_write(tilemap);
+        Tilemap shaped;
+
+        valid = !tilemap_read(shaped, bytes.data(), bytes.size(), width, height) && shaped.width == width && shaped.height == height;
+
+        if (valid)
+        {
+            tilemap = std::move(shaped);
+            state.width = width;
+            state.height = height;
+        }
+    }
+
+    // Written for another version of the map, or not a journal at all.
+    if (!valid)
+    {
+        file_unmap(file);
+
+        if (journal_set_aside(path, false))
+            return "The edit journal does not match the saved map and was set aside next to it.";
+
+        state.usable = false;
+        return "The edit journal does not match the saved map and could not be set aside, autosave is off for this map.";
+    }
+
+    std::unordered_map<uint32_t, size_t> slots;
+
+    state.size = sHeaderSize;
+
+    while (in.data < in.end)
+    {
+        auto kind = static_cast<RecordKind>(in.u8());
+        uint32_t length = in.u32();
+        uint32_t checksum = in.u32();
+
+        bool intact = !in.failed && in.need(length) && journal_checksum(in.data, length) == checksum;
+
+        // A torn tail from a crash during an append, which the next append
+        // cuts off.
+        if (!intact && (in.failed || in.data + length == in.end))
+            break;
+
+        JournalReader payload{ in.data, in.data + length };
+        in.data += length;
+
+        bool applied = intact && (kind == RecordKind::Edit ? journal_apply_edit(payload, tilemap, state, slots) :
+                                  kind == RecordKind::Snapshot ? journal_apply_snapshot(payload, tilemap, state) : false);
+
+        // The records from here on are lost to the map, but stay readable in
+        // the copy.
+        if (!applied)
+        {
+            if (journal_set_aside(path, true))
+                return "The edit journal is damaged, recovery stopped early and the journal was copied next to the map.";
+
+            state.usable = false;
+            return "The edit journal is damaged, recovery stopped early and autosave is off for this map.";
+        }
+
+        state.size = static_cast<uint64_t>(in.data - file.data);
+        ++state.records;
+    }
+
+    return nullptr;
+}
+
+void journal_attach(Journal &journal, const std::string &mapPath, const JournalState &state)
+{
+    journal_close(journal);
+
+    if (!state.usable)
+        return;
+
+    journal.path = journal_path(mapPath);
+    journal.width = state.width;
+    journal.height = state.height;
+    journal.hash = state.hash;
+    journal.size = state.size;
+    journal.records = state.records;
+}
+
+const char *journal_compact(Journal &journal, const std::string &mapPath, const Tilemap &tilemap)
+{
+    std::error_code ec;
+
+    file_close(journal.file);
+    if (!journal.path.empty())
+        std::filesystem::remove(journal.path, ec);
+
+    // A journal this one does not own holds edits of the version of the map
+    // that was just overwritten.
+    std::string path = journal_path(mapPath);
+
+    if (path != journal.path && std::filesystem::file_size(path, ec) > sHeaderSize && !ec)
+    {
+        if (!journal_set_aside(path, false))
+        {
+            journal_close(journal);
+            return "The map's old edit journal could not be set aside, autosave is off for this map.";
+        }
+    }
+    else
+    {
+        std::filesystem::remove(path, ec);
+    }
+
+    JournalState state;
+    journal_base(tilemap, state);
+    journal_attach(journal, mapPath, state);
+    return nullptr;
+}
+
+static const char *journal_fail(Journal &journal, const char *error)
+{
+    file_close(journal.file);
+    journal.path.clear();
+    return error;
+}
+
+static size_t journal_begin_record(Journal &journal, RecordKind kind)
+{
+    auto &data = journal.buffer;
+    JournalWriter out{ data };
+    data.clear();
+
+    // The file is opened, or created, by the first record since attaching.
+    if (journal.size == 0)
+    {
+        data.insert(data.end(), sMagic, sMagic + sizeof(sMagic));
+        out.u32(sVersion);
+        out.u32(static_cast<uint32_t>(journal.width));
+        out.u32(static_cast<uint32_t>(journal.height));
+        out.u64(journal.hash);
+    }
+
+    out.u8(static_cast<unsigned int>(kind));
+    out.u32(0);
+    out.u32(0);
+    return data.size();
+}
+
+static const char *journal_end_record(Journal &journal, size_t payload)
+{
+    auto &data = journal.buffer;
+    JournalWriter out{ data };
+
+    out.patch32(payload - 8, static_cast<uint32_t>(data.size() - payload));
+    out.patch32(payload - 4, journal_checksum(data.data() + payload, data.size() - payload));
+
+    if (journal.file.handle == -1)
+    {
+        if (!file_open_append(journal.file, journal.path, journal.size))
+            return journal_fail(journal, "Could not open the edit journal, autosave is off for this map.");
+
+        journal.lastSync = std::chrono::steady_clock::now();
+    }
+
+    if (!file_append(journal.file, data.data(), data.size()))
+        return journal_fail(journal, "Could not write the edit journal, autosave is off for this map.");
+
+    journal.size += data.size();
+    ++journal.records;
+    journal.unsynced = true;
+
+    journal_sync(journal, false);
+    return nullptr;
+}
+
+const char *journal_append(Journal &journal, const TileDelta *deltas, size_t count, bool undo)
+{
+    if (journal.path.empty() || count == 0)
+        return nullptr;
+
+    size_t payload = journal_begin_record(journal, RecordKind::Edit);
+    JournalWriter out{ journal.buffer };
+
+    out.varint(count);
+    int64_t cell = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto &delta = undo ? deltas[count - 1 - i] : deltas[i];
+        int64_t distance = static_cast<int64_t>(delta.index) - cell;
+
+        out.varint(static_cast<uint64_t>(distance) << 1 ^ static_cast<uint64_t>(distance >> 63));
+        out.u16(undo ? delta.newTile : delta.oldTile);
+        out.u16(undo ? delta.oldTile : delta.newTile);
+        cell = delta.index;
+    }
+
+    return journal_end_record(journal, payload);
+}
+
+const char *journal_snapshot(Journal &journal, const Tilemap &tilemap)
+{
+    if (journal.path.empty())
+        return nullptr;
+
+    size_t payload = journal_begin_record(journal, RecordKind::Snapshot);
+    JournalWriter out{ journal.buffer };
+
+    out.u32(static_cast<uint32_t>(tilemap.width));
+    out.u32(static_cast<uint32_t>(tilemap.height));
+
+    for (int y = 0; y < tilemap.height; ++y)
+    for (int x = 0; x < tilemap.width; ++x)
+        out.u16(tilemap_get(tilemap, x, y));
+
+    return journal_end_record(journal, payload);
+}
+
+void journal_sync(Journal &journal, bool force)
+{
+    if (!journal.unsynced)
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+    if (!force && now - journal.lastSync < sSyncInterval)
+        return;
+
+    file_sync(journal.file);
+    journal.unsynced = false;
+    journal.lastSync = now;
+}
+
+double journal_sync_due(const Journal &journal)
+{
+    if (!journal.unsynced)
+        return -1.0;
+
+    std::chrono::duration<double> left = journal.lastSync + sSyncInterval - std::chrono::steady_clock::now();
+    return std::max(left.count(), 0.0);
+}
+
+void journal_close(Journal &journal)
+{
+    journal_sync(journal, true);
+    file_close(journal.file);
+    journal.path.clear();
+    journal.records = 0;
+}
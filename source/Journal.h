@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ActionStack.h"
+#include "File.h"
+#include "Tilemap.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Autosave for one open map. Every committed edit is appended to
+// "<map>.journal" next to the saved file, and reopening the map replays the
+// journal on top of it. Saving the map empties the journal again.
+//
+// Appends reach the OS immediately, so an editor crash loses nothing; they
+// are flushed to disk every few seconds, which bounds what a power loss can
+// take. The file is only created by the first edit after opening or saving.
+struct Journal
+{
+    std::string path; // Empty while detached, e.g. for untitled maps.
+    AppendFile file;
+
+    // The map as saved, which the journal's header identifies.
+    int width = 0, height = 0;
+    uint64_t hash = 0;
+
+    uint64_t size = 0; // Valid bytes in the file, 0 until the header is written.
+    size_t records = 0;
+
+    bool unsynced = false;
+    std::chrono::steady_clock::time_point lastSync;
+
+    std::vector<unsigned char> buffer; // Reused for every record.
+};
+
+// The journal of a map as found on disk, see journal_replay().
+struct JournalState
+{
+    int width = 0, height = 0;
+    uint64_t hash = 0;
+    uint64_t size = 0;
+    size_t records = 0;
+
+    // Net change of every replayed cell, first old to last new value, so the
+    // recovery can be undone as one action. Empty if a resize was replayed.
+    std::vector<TileDelta> changes;
+    bool resized = false;
+
+    // Cleared when a journal that could not be replayed could not be moved
+    // out of the way either; journal_attach() then leaves it alone.
+    bool usable = true;
+};
+
+std::string journal_path(const std::string &mapPath);
+uint64_t journal_hash(const Tilemap &tilemap);
+
+// Describes tilemap as the saved state, with nothing journaled yet.
+void journal_base(const Tilemap &tilemap, JournalState &state);
+
+// Applies the journal of mapPath to tilemap, which must be the map as loaded
+// from mapPath, and gives tilemap the width and height it was edited at. A
+// torn last record, which a crash during an append leaves behind, is
+// dropped. A journal written for another version of the map is moved to
+// "<journal>.N" and a damaged one is copied there, so their records are
+// never overwritten. Returns an error message or nullptr; the records
+// before an error stay applied.
+const char *journal_replay(const std::string &mapPath, Tilemap &tilemap, JournalState &state);
+
+// Journals further edits of the map at mapPath, continuing after the records
+// that journal_replay() found.
+void journal_attach(Journal &journal, const std::string &mapPath, const JournalState &state);
+
+// The map was just written to mapPath: drops this journal and starts an
+// empty one based on tilemap. A journal of mapPath that belongs to someone
+// else is set aside like a stale one.
+const char *journal_compact(Journal &journal, const std::string &mapPath, const Tilemap &tilemap);
+
+// Records cell changes in order, or, for an undo, the old values in reverse
+// order. A snapshot records the whole map after a resize or remap. On error
+// the journal detaches itself.
+const char *journal_append(Journal &journal, const TileDelta *deltas, size_t count, bool undo);
+const char *journal_snapshot(Journal &journal, const Tilemap &tilemap);
+
+// Flushes appended records to disk once the sync interval has passed.
+void journal_sync(Journal &journal, bool force);
+
+// Seconds until journal_sync() flushes the appended records, or a negative
+// value if there is nothing to flush.
+double journal_sync_due(const Journal &journal);
+void journal_close(Journal &journal);
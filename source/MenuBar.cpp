@@ -5,12 +5,22 @@
 #include "Global.h"
 #include "ActionStack.h"
 
+#include <cstdio>
+
 void main_menu_bar(void)
 {
     if (ImGui::BeginMainMenuBar())
     {
         if (ImGui::BeginMenu("File"))
         {
+            if (ImGui::MenuItem("New Tab", "Ctrl+T"))
+                new_document();
+
+            if (ImGui::MenuItem("Close Tab", "Ctrl+W", nullptr, global.documents.size() > 1))
+                close_document();
+
+            ImGui::Separator();
+
             if (ImGui::MenuItem("Open Tilemap", "Ctrl+O"))
                 open_tilemap();
 
@@ -28,9 +38,20 @@ void main_menu_bar(void)
             if (ImGui::MenuItem("Open Secondary Tileset", "Ctrl+Shift+2"))
                 open_secondary_tileset();
 
+            if (ImGui::MenuItem("Open Both Tilesets"))
+                open_tilesets();
+
             if (ImGui::MenuItem("Open Palettes", "Ctrl+Shift+O"))
                 open_palettes();
 
+            ImGui::Separator();
+
+            if (ImGui::MenuItem("Import Image"))
+                import_tilemap();
+
+            if (ImGui::MenuItem("Replace Tiles in Project..."))
+                replace_tiles_in_project();
+
             ImGui::EndMenu();
         }
 
@@ -42,12 +63,105 @@ void main_menu_bar(void)
             if (ImGui::MenuItem("Redo", "Ctrl+Y", nullptr, action_stack_can_redo()))
                 action_stack_do_redo();
 
+            ImGui::Separator();
+
+            if (ImGui::BeginMenu("Map Size"))
+            {
+                static constexpr int sGbaSizes[][2] = { { 32, 32 }, { 64, 32 }, { 32, 64 }, { 64, 64 } };
+                static int sSize[2] = { 32, 32 };
+
+                auto &tilemap = global.document->tilemap;
+
+                for (auto &size : sGbaSizes)
+                {
+                    char label[16];
+                    snprintf(label, sizeof(label), "%ix%i", size[0], size[1]);
+                    if (ImGui::MenuItem(label, nullptr, tilemap.width == size[0] && tilemap.height == size[1]))
+                        resize_tilemap(size[0], size[1]);
+                }
+
+                ImGui::Separator();
+
+                ImGui::InputInt2("###MapSize", sSize);
+                ImGui::SameLine();
+                if (ImGui::Button("Resize"))
+                    resize_tilemap(sSize[0], sSize[1]);
+
+                ImGui::EndMenu();
+            }
+
+            ImGui::EndMenu();
+        }
+
+        if (ImGui::BeginMenu("Tools"))
+        {
+            if (ImGui::MenuItem("Optimize Tileset"))
+                optimize_tileset();
+
             ImGui::EndMenu();
         }
 
         if (ImGui::BeginMenu("View"))
         {
             ImGui::MenuItem("Show Screen Bounds", nullptr, &global.drawScreenBounds);            
+            ImGui::MenuItem("Tile Usage", nullptr, &global.showTileUsage);
+            ImGui::MenuItem("Find Tile", "Ctrl+F", &global.showFindTile);
+
+            if (ImGui::BeginMenu("Renderer Backend"))
+            {
+                auto &r = global.renderer;
+
+                if (ImGui::MenuItem("OpenGL", nullptr, r.backend == RendererBackend::OpenGL))
+                    renderer_set_backend(r, RendererBackend::OpenGL);
+
+                char label[32];
+                snprintf(label, sizeof(label), "Software (%s)", raster_kernel_name());
+                if (ImGui::MenuItem(label, nullptr, r.backend == RendererBackend::Software))
+                    renderer_set_backend(r, RendererBackend::Software);
+
+                ImGui::EndMenu();
+            }
+
+            if (ImGui::BeginMenu("Map Renderer", global.renderer.backend == RendererBackend::OpenGL))
+            {
+                auto &r = global.renderer;
+
+                if (ImGui::MenuItem("Shader Decode", nullptr, r.mapPipeline == MapPipeline::Texture))
+                    renderer_set_map_pipeline(r, MapPipeline::Texture);
+
+                if (ImGui::MenuItem("Vertex Quads", nullptr, r.mapPipeline == MapPipeline::Vertex))
+                    renderer_set_map_pipeline(r, MapPipeline::Vertex);
+
+                ImGui::EndMenu();
+            }
+
+            if (ImGui::BeginMenu("Frame Cap"))
+            {
+                static constexpr int sFrameCaps[] = { 30, 60, 120, 144 };
+
+                for (int cap : sFrameCaps)
+                {
+                    char label[16];
+                    snprintf(label, sizeof(label), "%i FPS", cap);
+                    if (ImGui::MenuItem(label, nullptr, global.frameCap == cap))
+                        global.frameCap = cap;
+                }
+
+                if (ImGui::MenuItem("Unlimited", nullptr, global.frameCap == 0))
+                    global.frameCap = 0;
+
+                ImGui::EndMenu();
+            }
+
+#ifdef PARALLAX_PROFILER
+            ImGui::Separator();
+
+            ImGui::MenuItem("Profiler", nullptr, &global.showProfiler);
+
+            if (ImGui::MenuItem("Export Trace"))
+                export_profiler_trace();
+#endif
+
             ImGui::EndMenu();
         }
 
@@ -0,0 +1,190 @@
+#include "Palette.h"
+#include "File.h"
+#include "ThreadPool.h"
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+
+static constexpr char sText_JASC_PAL[] = "JASC-PAL";
+static constexpr char sText_PAL_0100[] = "0100";
+
+struct Tokenizer
+{
+    const char *cur, *end;
+
+    std::string_view next(void)
+    {
+        while (cur < end && (*cur == ' ' || *cur == '\t' || *cur == '\r' || *cur == '\n')) ++cur;
+
+        const char *start = cur;
+        while (cur < end && !(*cur == ' ' || *cur == '\t' || *cur == '\r' || *cur == '\n')) ++cur;
+
+        return std::string_view(start, cur - start);
+    }
+
+    bool next_int(int &value)
+    {
+        auto token = next();
+        auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+        return !token.empty() && result.ec == std::errc() && result.ptr == token.data() + token.size();
+    }
+};
+
+const char *palette_parse_jasc(const char *text, size_t size, Palette out)
+{
+    Tokenizer tokens{ text, text + size };
+    int numColors;
+
+    if (tokens.next() != sText_JASC_PAL)
+        return "Invalid JASC-PAL signature.";
+
+    if (tokens.next() != sText_PAL_0100)
+        return "Unsupported JASC-PAL version.";
+
+    if (!tokens.next_int(numColors))
+        return "Could not parse number of colors.";
+
+    if (numColors < 1 || numColors > 256)
+        return "Unsupported number of colors. (Color count must be between 1 and 256)";
+
+    memset(out, 0, sizeof(Palette));
+
+    for (int i = 0; i < numColors; i++)
+    {
+        int r, g, b;
+
+        if (!tokens.next_int(r) || !tokens.next_int(g) || !tokens.next_int(b))
+            return "Error parsing color components.";
+
+        if (r < 0 || g < 0 || b < 0 || r > 255 || g > 255 || b > 255)
+            return "Color component value must be between 0 and 255.";
+
+        if (i < 16)
+            out[i] = { static_cast<unsigned char>(r), static_cast<unsigned char>(g), static_cast<unsigned char>(b) };
+    }
+
+    return nullptr;
+}
+
+// Little-endian BGR555 as stored in GBA palette RAM.
+const char *palette_parse_gbapal(const unsigned char *data, size_t size, Palette out)
+{
+    if (size < 32 || size % 2 != 0)
+        return "Binary palette must contain at least 16 colors.";
+
+    for (int i = 0; i < 16; ++i)
+    {
+        unsigned int color = data[i * 2] | (data[i * 2 + 1] << 8);
+
+        out[i] = {
+            static_cast<unsigned char>(((color >> 0) & 0x1F) * 255 / 31),
+            static_cast<unsigned char>(((color >> 5) & 0x1F) * 255 / 31),
+            static_cast<unsigned char>(((color >> 10) & 0x1F) * 255 / 31)
+        };
+    }
+
+    return nullptr;
+}
+
+const char *palette_load_file(const std::string &path, Palette out)
+{
+    MappedFile file;
+
+    if (!file_map(file, path))
+        return "Could not open palette file.";
+
+    if (file_extension(path) == ".gbapal")
+        return palette_parse_gbapal(file.data, file.size, out);
+
+    return palette_parse_jasc(reinterpret_cast<const char *>(file.data), file.size, out);
+}
+
+std::string palette_write_jasc(const Palette palette)
+{
+    std::string text = std::string(sText_JASC_PAL) + "\r\n" + sText_PAL_0100 + "\r\n16\r\n";
+
+    for (int i = 0; i < 16; ++i)
+    {
+        char line[16];
+        snprintf(line, sizeof(line), "%d %d %d\r\n", palette[i].r, palette[i].g, palette[i].b);
+        text += line;
+    }
+
+    return text;
+}
+
+const char *palette_save_file(const std::string &path, const Palette palette)
+{
+    std::string text = palette_write_jasc(palette);
+
+    if (!file_write_atomic(path, text.data(), text.size()))
+        return "Could not write palette file.";
+
+    return nullptr;
+}
+
+// Returns the slot for names like "07.pal" or "07.gbapal", otherwise -1.
+static int palette_slot(const std::filesystem::path &path, bool &binary)
+{
+    auto stem = path.stem().string();
+    auto ext = file_extension(path.string());
+
+    if (stem.size() != 2 || !(ext == ".pal" || ext == ".gbapal"))
+        return -1;
+
+    int slot;
+    if (std::from_chars(stem.data(), stem.data() + 2, slot).ptr != stem.data() + 2 || slot < 0 || slot > 15)
+        return -1;
+
+    binary = ext == ".gbapal";
+    return slot;
+}
+
+unsigned int palette_load_directory(const std::string &path, Palette palettes[16], const char **error)
+{
+    std::string files[16];
+    bool binary[16]{};
+
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(path, ec))
+    {
+        bool isBinary;
+        int slot = palette_slot(entry.path(), isBinary);
+
+        // Prefer JASC-PAL when both formats are present.
+        if (slot < 0 || (!files[slot].empty() && !binary[slot]))
+            continue;
+
+        files[slot] = entry.path().string();
+        binary[slot] = isBinary;
+    }
+
+    const char *errors[16]{};
+    thread_pool_parallel_for(16, [&](size_t i) {
+        if (!files[i].empty())
+            errors[i] = palette_load_file(files[i], palettes[i]);
+    });
+
+    unsigned int loaded = 0;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        if (files[i].empty()) continue;
+
+        if (errors[i])
+        {
+            if (error && !*error) *error = errors[i];
+            continue;
+        }
+
+        loaded |= 1 << i;
+    }
+
+    if (error && ec && !*error)
+        *error = "Could not read palette directory.";
+
+    return loaded;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Utils.h"
+
+#include <cstddef>
+#include <string>
+
+// All functions return nullptr on success, otherwise a description of the error.
+const char *palette_parse_jasc(const char *text, size_t size, Palette out);
+const char *palette_parse_gbapal(const unsigned char *data, size_t size, Palette out);
+const char *palette_load_file(const std::string &path, Palette out);
+const char *palette_save_file(const std::string &path, const Palette palette);
+std::string palette_write_jasc(const Palette palette);
+
+// Loads NN.pal / NN.gbapal (NN = 00..15) from a directory. Returns a bit mask
+// of the palette slots that were loaded.
+unsigned int palette_load_directory(const std::string &path, Palette palettes[16], const char **error = nullptr);
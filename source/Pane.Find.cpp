@@ -0,0 +1,160 @@
+#include "Pane.Find.h"
+#define IMGUI_DEFINE_MATH_OPERATORS
+#include <imgui.h>
+
+#include "ActionStack.h"
+#include "Global.h"
+#include "Widget.TileGrid.h"
+
+#include <algorithm>
+#include <vector>
+
+static int sMode = 0; // 0: tile, 1: palette
+static int sFind = 0, sReplace = 0;
+static bool sHighlight = true;
+
+static unsigned short find_mask(void)
+{
+    return sMode == 0 ? Mask::Index : 0xF000;
+}
+
+static unsigned short find_bits(int value)
+{
+    return static_cast<unsigned short>(sMode == 0 ? value : value << 12);
+}
+
+static const std::vector<uint32_t> &find_cells(Document &doc)
+{
+    const auto &usage = tilemap_usage(doc.tilemap);
+    return sMode == 0 ? usage.tiles[sFind] : usage.palettes[sFind];
+}
+
+// Rewrites the matched bits of every matching cell, in the selection if there
+// is one and otherwise across the map, as a single undo action.
+static void replace_all(Document &doc)
+{
+    auto &tilemap = doc.tilemap;
+    unsigned short mask = find_mask(), from = find_bits(sFind), to = find_bits(sReplace);
+
+    // The index changes under our feet while replacing.
+    std::vector<uint32_t> cells = doc.selection.empty() ? find_cells(doc) : doc.selection;
+    std::vector<TileDelta> deltas;
+
+    for (uint32_t cell : cells)
+    {
+        int x = cell % tilemap.width, y = cell / tilemap.width;
+        unsigned short old = tilemap_get(tilemap, x, y);
+
+        if (!old || (old & mask) != from)
+            continue;
+
+        unsigned short tile = (old & ~mask) | to;
+        deltas.push_back({ cell, old, tile });
+        tilemap_set(tilemap, x, y, tile);
+    }
+
+    action_stack_end_stroke();
+    action_stack_add_undo_action(deltas.data(), deltas.size());
+
+    global.statusText = "Replaced " + std::to_string(deltas.size()) + " cells.";
+}
+
+static bool find_value_input(const char *id, int &value)
+{
+    // Tiles are entered in hex, like the Tile Usage window.
+    static constexpr int sStep = 1, sStepFast = 16;
+    ImGui::SetNextItemWidth(120.0f * global.dpiScale);
+    bool changed = ImGui::InputScalar(id, ImGuiDataType_S32, &value, &sStep, &sStepFast, sMode == 0 ? "%03X" : "%d", sMode == 0 ? ImGuiInputTextFlags_CharsHexadecimal : 0);
+
+    value = std::clamp(value, 0, sMode == 0 ? static_cast<int>(Mask::Index) : 15);
+
+    ImGui::SameLine();
+    ImGui::PushID(id);
+    if (ImGui::Button("From Brush") && !global.brush.selection.empty())
+    {
+        unsigned short entry = global.brush.selection[0];
+        value = sMode == 0 ? entry & Mask::Index : entry >> 12;
+        changed = true;
+    }
+    ImGui::PopID();
+
+    return changed;
+}
+
+// Finds, selects and replaces the uses of a tile or palette in the active
+// map. Queries come from the map's reverse index, so they cost no scan.
+void find_tile_window(bool *open)
+{
+    if (!*open)
+        return;
+
+    ImGui::SetNextWindowSize(ImVec2(360.0f, 0.0f), ImGuiCond_FirstUseEver);
+
+    if (ImGui::Begin("Find Tile", open))
+    {
+        auto &doc = *global.document;
+
+        ImGui::RadioButton("Tile", &sMode, 0);
+        ImGui::SameLine();
+        ImGui::RadioButton("Palette", &sMode, 1);
+
+        find_value_input("Find###FindValue", sFind);
+        find_value_input("Replace###ReplaceValue", sReplace);
+
+        const auto &cells = find_cells(doc);
+        ImGui::Text("%zu cells use it, %zu selected", cells.size(), doc.selection.size());
+
+        ImGui::Checkbox("Highlight", &sHighlight);
+        ImGui::SameLine();
+
+        if (ImGui::Button("Select All"))
+            doc.selection = cells;
+
+        ImGui::SameLine();
+        ImGui::BeginDisabled(doc.selection.empty());
+        if (ImGui::Button("Deselect"))
+            doc.selection.clear();
+        ImGui::EndDisabled();
+
+        if (ImGui::Button(doc.selection.empty() ? "Replace All" : "Replace in Selection"))
+            replace_all(doc);
+    }
+
+    ImGui::End();
+}
+
+static void find_tile_mark(const TileGrid &grid, uint32_t cell, int width, ImU32 color, bool filled)
+{
+    int x = cell % width, y = cell / width;
+
+    if (x < grid.visibleX0 || x >= grid.visibleX1 || y < grid.visibleY0 || y >= grid.visibleY1)
+        return;
+
+    auto drawList = ImGui::GetWindowDrawList();
+    ImVec2 pos = tile_grid_cell_pos(grid, x, y);
+
+    if (filled) drawList->AddRectFilled(pos, pos + ImVec2(grid.cellSize, grid.cellSize), color);
+    else drawList->AddRect(pos + ImVec2(0.5f, 0.5f), pos + ImVec2(grid.cellSize, grid.cellSize) - ImVec2(0.5f, 0.5f), color);
+}
+
+void find_tile_overlay(const TileGrid &grid)
+{
+    if (!global.showFindTile)
+        return;
+
+    auto &doc = *global.document;
+    int width = doc.tilemap.width;
+    uint32_t cells = static_cast<uint32_t>(width) * doc.tilemap.height;
+
+    for (uint32_t cell : doc.selection)
+    {
+        if (cell < cells)
+            find_tile_mark(grid, cell, width, IM_COL32(80, 160, 255, 96), true);
+    }
+
+    if (sHighlight)
+    {
+        for (uint32_t cell : find_cells(doc))
+            find_tile_mark(grid, cell, width, IM_COL32(255, 220, 0, 255), false);
+    }
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+struct TileGrid;
+
+void find_tile_window(bool *open);
+
+// Draws the highlighted uses and the selection over the map grid.
+void find_tile_overlay(const TileGrid &grid);
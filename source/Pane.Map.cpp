@@ -1,93 +1,96 @@
 #include "Pane.Picker.h"
+#include "Pane.Find.h"
 #include "ActionStack.h"
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include <imgui.h>
 #include <imgui_internal.h>
 
 #include "Global.h"
+#include "Widget.TileGrid.h"
+#include "Scheduler.h"
 
-static unsigned short change_tile_palette(unsigned short tile, unsigned char palette)
-{
-    static constexpr unsigned int Mask = 0xF << 12;
-    tile &= ~Mask;
-    tile |= (palette & 0xF) << 12;
-    return tile;
-}
+#include <algorithm>
+#include <string>
 
-static void left_click(unsigned int startX, unsigned int startY)
+// Draws the rendered chunks that intersect the visible cell range and tells
+// the renderer which chunks to keep up to date, with a one chunk margin so
+// that scrolling rarely reveals a chunk that has not been rendered yet.
+static void draw_map_chunks(const TileGrid &grid)
 {
-    for (int y = 0; y < global.brush.height; ++y)
-    for (int x = 0; x < global.brush.width; ++x)
+    static constexpr int sChunk = TilemapChunk::Size;
+
+    auto drawList = ImGui::GetWindowDrawList();
+    auto &doc = *global.document;
+    const auto &tilemap = doc.tilemap;
+
+    int x0 = grid.visibleX0 / sChunk, x1 = (grid.visibleX1 + sChunk - 1) / sChunk;
+    int y0 = grid.visibleY0 / sChunk, y1 = (grid.visibleY1 + sChunk - 1) / sChunk;
+
+    renderer_set_map_view(doc.view, x0 - 1, y0 - 1, x1 + 1, y1 + 1);
+
+    for (int cy = y0; cy < y1; ++cy)
+    for (int cx = x0; cx < x1; ++cx)
     {
-        if ((startX + x) >= 32 || (startY + y) >= 32) continue;
+        unsigned int tex = renderer_get_map_chunk_texture(doc.view, cx + cy * tilemap.chunksX);
 
-        unsigned int i = (startX + x) + (startY + y) * 32;
+        if (!tex)
+        {
+            scheduler_invalidate();
+            continue;
+        }
 
-        global.tilemap[i] = global.brush.fromTileset ? 
-            change_tile_palette(global.brush.selection[x + y * global.brush.width], global.brush.palette) : 
-            global.brush.selection[x + y * global.brush.width];
+        // Chunks on the right and bottom edge may be partially outside the map.
+        int w = std::min(sChunk, tilemap.width - cx * sChunk);
+        int h = std::min(sChunk, tilemap.height - cy * sChunk);
+
+        ImVec2 pos = tile_grid_cell_pos(grid, cx * sChunk, cy * sChunk);
+        drawList->AddImage((ImTextureID)(uintptr_t)tex, pos, pos + ImVec2(w, h) * grid.cellSize, ImVec2(0.0f, 0.0f), ImVec2(w, h) / sChunk);
     }
 }
 
 static void tilemap_window(void)
 {
     auto drawList = ImGui::GetWindowDrawList();
-
-    ImTextureID tex_id = (ImTextureID)(uintptr_t)global.renderer.mapFinalTex;
-
-    static float zoom = 1.0f;
+    auto &tilemap = global.document->tilemap;
 
     float scale = 4.0f * global.zoomScale;
-    ImVec2 size = ImVec2(256, 256);
     ImVec2 tilesize = ImVec2(8, 8);
 
-    static constexpr int sTilesInRow = 32;
-
-    bool has_hovered = false;
-    unsigned int hovered_item = 0;
-
     static int sStartDrag = 0;
     static int sWidth = 1, sHeight = 1;
+    static bool sPainting = false;
 
-    for (int i = 0; i < 1024; ++i)
-    {
-        int x = i % sTilesInRow, y = i / sTilesInRow;
-        ImVec2 uv0 = ImVec2(i % 32, i / 32) * tilesize / size;
-        ImVec2 pos = ImGui::GetCursorScreenPos() + ImVec2(0.5f, 0.5f) + ImVec2(x, y) * tilesize * scale;
-        drawList->AddImage(tex_id, pos, pos + tilesize * scale, uv0, uv0 + tilesize / size);
+    TileGrid grid{};
+    grid.columns = tilemap.width;
+    grid.rows = tilemap.height;
+    grid.cellSize = tilesize.x * scale;
+    tile_grid("###TilemapGrid", grid);
 
-        ImRect bb_ = ImRect(pos, pos + tilesize * scale);
-        bool hovered = ImGui::ItemHoverable(bb_, ImGui::GetCurrentContext()->CurrentWindow->GetIDFromRectangle(bb_), ImGuiItemFlags_AllowOverlap);
+    draw_map_chunks(grid);
+    find_tile_overlay(grid);
 
-        if (hovered)
-        {
-            has_hovered = true;
-            hovered_item = i;
-        }
-    }
+    bool has_hovered = grid.hovered;
+    int hoveredX = grid.hoveredCell % tilemap.width, hoveredY = grid.hoveredCell / tilemap.width;
 
-    static Action actionBuffer;
+    // A stroke starts with a click on the map and may leave it while the
+    // button is held.
+    if (ImGui::IsMouseReleased(0) && sPainting)
+    {
+        action_stack_end_stroke();
+        sPainting = false;
+    }
 
     if (has_hovered)
     {
         if (ImGui::IsMouseClicked(0))
-            memcpy(actionBuffer.oldTiles, global.tilemap, 32 * 32 * sizeof(unsigned short));
-
-        if (ImGui::IsMouseReleased(0))
-        {
-            memcpy(actionBuffer.newTiles, global.tilemap, 32 * 32 * sizeof(unsigned short));
-            action_stack_add_undo_action(actionBuffer);
-        }
+            sPainting = true;
 
-        if (ImGui::IsMouseDown(0))
-        {
-            auto x = hovered_item % sTilesInRow, y = hovered_item / sTilesInRow;
-            left_click(x, y);
-        }
+        if (ImGui::IsMouseDown(0) && sPainting)
+            brush_stamp(global.brush, tilemap, hoveredX, hoveredY);
 
         if (ImGui::IsMouseClicked(1)) 
         {
-            sStartDrag = hovered_item; 
+            sStartDrag = grid.hoveredCell; 
             global.brush.fromTileset = false;
         }
 
@@ -97,14 +100,12 @@ static void tilemap_window(void)
             sWidth = std::max<int>(delta.x / (tilesize.x * scale), 0) + 1;
             sHeight = std::max<int>(delta.y / (tilesize.y * scale), 0) + 1;
 
-            int x = sStartDrag % 32, y = sStartDrag / 32;
-            ImVec2 pos = ImGui::GetCursorScreenPos() + ImVec2(0.5f, 0.5f) + ImVec2(x, y) * tilesize * scale;
+            ImVec2 pos = tile_grid_cell_pos(grid, sStartDrag % tilemap.width, sStartDrag / tilemap.width);
             drawList->AddRect(pos - ImVec2(0.5f, 0.5f), pos + ImVec2(sWidth, sHeight) * tilesize * scale + ImVec2(0.5f, 0.5f), IM_COL32(255, 255, 255, 255));
         }
         else
         {
-            int x = hovered_item % 32, y = hovered_item / 32;
-            ImVec2 pos = ImGui::GetCursorScreenPos() + ImVec2(0.5f, 0.5f) + ImVec2(x, y) * tilesize * scale;
+            ImVec2 pos = tile_grid_cell_pos(grid, hoveredX, hoveredY);
             drawList->AddRect(pos - ImVec2(0.5f, 0.5f), pos + ImVec2(global.brush.width, global.brush.height) * tilesize * scale + ImVec2(0.5f, 0.5f), IM_COL32(255, 255, 255, 255));
         }
 
@@ -117,11 +118,10 @@ static void tilemap_window(void)
             for (int y = 0; y < sHeight; ++y)
             for (int x = 0; x < sWidth; ++x)
             {
-                int startX = sStartDrag % 32, 
-                    startY = sStartDrag / 32;
+                int startX = sStartDrag % tilemap.width, 
+                    startY = sStartDrag / tilemap.width;
                 
-                uint16_t idx = (startX + x) + (startY + y) * 32;
-                brush.selection[x + y * sWidth] = global.tilemap[idx];
+                brush.selection[x + y * sWidth] = tilemap_get(tilemap, startX + x, startY + y);
             }
 
             brush.width = sWidth;
@@ -138,22 +138,63 @@ static void tilemap_window(void)
 
     if (global.drawScreenBounds)
     {
-        ImVec2 pos = ImGui::GetCursorScreenPos();
+        ImVec2 pos = tile_grid_cell_pos(grid, 0, 0) - ImVec2(0.5f, 0.5f);
         drawList->AddRect(pos - ImVec2(0.5f, 0.5f), pos + tilesize * scale * ImVec2(30.0f, 20.0f) + ImVec2(0.5f, 0.5f), IM_COL32(255, 255, 255, 255));
     }
+}
 
-    ImVec2 widgetsize = ImVec2(sTilesInRow, static_cast<int>(1024 / sTilesInRow)) * tilesize;
-    ImRect bb(ImGui::GetCursorScreenPos(), ImGui::GetCursorScreenPos() + widgetsize * scale + ImVec2(1.0f, 1.0f));
+// One tab per document. A tab that ImGui selects, e.g. after a click or
+// after the active tab was closed, becomes the active document.
+static void document_tabs(void)
+{
+    static constexpr ImGuiTabBarFlags sFlags = ImGuiTabBarFlags_AutoSelectNewTabs | ImGuiTabBarFlags_FittingPolicyScroll;
 
-    ImGui::ItemSize(bb);
-    ImGui::ItemAdd(bb, 0);
+    if (!ImGui::BeginTabBar("###Documents", sFlags))
+        return;
+
+    Document *closed = nullptr;
+    bool closable = global.documents.size() > 1;
+
+    for (auto &doc : global.documents)
+    {
+        bool open = true;
+        std::string label = document_title(*doc) + "###Document" + std::to_string(doc->id);
+
+        if (ImGui::BeginTabItem(label.c_str(), closable ? &open : nullptr))
+        {
+            if (global.document != doc.get())
+                document_activate(*doc);
+
+            ImGui::EndTabItem();
+        }
+
+        if (ImGui::IsItemHovered() && !doc->path.empty())
+            ImGui::SetTooltip("%s", doc->path.c_str());
+
+        if (!open)
+            closed = doc.get();
+    }
+
+    ImGui::EndTabBar();
+
+    if (closed)
+        document_close(*closed);
 }
 
 void tilemap_pane(void)
 {
+    ImGui::BeginGroup();
+    document_tabs();
+
+    // Keyed by document, so every tab keeps its own scroll position.
+    ImGui::PushID(global.document->id);
+
     if (ImGui::BeginChild("Tilemap", ImVec2(0.0f, 0.0f), 0, ImGuiWindowFlags_HorizontalScrollbar))
     {
         tilemap_window();
         ImGui::EndChild();
     }
+
+    ImGui::PopID();
+    ImGui::EndGroup();
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <imgui_internal.h>
 
 #include "Global.h"
+#include "Widget.TileGrid.h"
 
 template<class T>
 static inline void swap_val(T *v1, T *v2)
@@ -21,47 +22,28 @@ static void tileset_selector(void)
     bool mouseClicked = ImGui::IsMouseClicked(0);
     bool mouseReleased = ImGui::IsMouseReleased(0);
 
-    ImTextureID tex_id = (ImTextureID)(uintptr_t)global.renderer.pickerFinalTex;
     float scale = 3.0f;
-    ImVec2 size = ImVec2(128, 512);
     ImVec2 tilesize = ImVec2(8, 8);
 
     static constexpr int sTilesInRow = 16;
     static int sStartDrag = 0;
     static int sWidth = 1, sHeight = 1;
-    bool anyHovered = false; 
 
-    for (int i = 0; i < 1024; ++i)
-    {
-        int x = i % sTilesInRow, y = i / sTilesInRow;
-
-        ImVec2 uv0 = ImVec2(i % 16, i / 16) * tilesize / size;
-        ImVec2 uv1 = uv0 + tilesize / size;
-
-        // if (global.brush.xflip)
-        //     swap_val(&uv0.x, &uv1.x);
-        
-        // if (global.brush.yflip)
-        //     swap_val(&uv0.y, &uv1.y);
-
-        ImVec2 pos = ImGui::GetCursorScreenPos() + ImVec2(0.5f, 0.5f) + ImVec2(x, y) * tilesize * scale;
-        drawList->AddImage(tex_id, pos, pos + tilesize * scale, uv0, uv1);
+    TileGrid grid{};
+    grid.texture = (ImTextureID)(uintptr_t)global.renderer.pickerFinalTex;
+    grid.uv0 = ImVec2(global.renderer.pickerPalette / 16.0f, 0.0f);
+    grid.uv1 = ImVec2((global.renderer.pickerPalette + 1) / 16.0f, 1.0f);
+    grid.columns = sTilesInRow;
+    grid.rows = 1024 / sTilesInRow;
+    grid.cellSize = tilesize.x * scale;
+    tile_grid("###TilesetGrid", grid);
 
-        ImRect bb_ = ImRect(pos, pos + tilesize * scale);
-        auto id_ = ImGui::GetCurrentContext()->CurrentWindow->GetIDFromRectangle(bb_);
-        bool hovered = ImGui::ItemHoverable(bb_, id_, 0);
-        // bool pressed = ImGui::ButtonBehavior(bb_, ImGui::GetCurrentContext()->CurrentWindow->GetIDFromRectangle(bb_), &hovered, &held);
+    bool anyHovered = grid.hovered;
 
-        if (hovered)
-        {
-            if (mouseClicked) 
-            {
-                sStartDrag = i; 
-                global.brush.fromTileset = true;
-            }
-
-            anyHovered = true;
-        } 
+    if (anyHovered && mouseClicked)
+    {
+        sStartDrag = grid.hoveredCell;
+        global.brush.fromTileset = true;
     }
 
     if (anyHovered && mouseDown)
@@ -99,21 +81,16 @@ static void tileset_selector(void)
         brush.height = sHeight;
     }
 
-    ImVec2 widgetsize = ImVec2(sTilesInRow, static_cast<int>(1024 / sTilesInRow)) * tilesize;
-    ImRect bb(ImGui::GetCursorScreenPos(), ImGui::GetCursorScreenPos() + widgetsize * scale + ImVec2(1.0f, 1.0f));
-
     if (global.brush.fromTileset)
     {
-        int x = sStartDrag % sTilesInRow, y = sStartDrag / sTilesInRow;
-        ImVec2 pos = ImGui::GetCursorScreenPos() + ImVec2(0.5f, 0.5f) + ImVec2(x, y) * tilesize * scale;
+        ImVec2 pos = tile_grid_cell_pos(grid, sStartDrag % sTilesInRow, sStartDrag / sTilesInRow);
         drawList->AddRect(pos - ImVec2(0.5f, 0.5f), pos + ImVec2(sWidth, sHeight) * tilesize * scale + ImVec2(0.5f, 0.5f), IM_COL32(255, 255, 255, 255));
     }
 
     if (global.brush.width == 1 && global.brush.height == 1)
     {
         int tile = global.brush.selection[0] & Mask::Index;
-        int x = tile % sTilesInRow, y = tile / sTilesInRow;
-        ImVec2 pos = ImGui::GetCursorScreenPos() + ImVec2(0.5f, 0.5f) + ImVec2(x, y) * tilesize * scale;
+        ImVec2 pos = tile_grid_cell_pos(grid, tile % sTilesInRow, tile / sTilesInRow);
         drawList->AddRect(pos - ImVec2(0.5f, 0.5f), pos + tilesize * scale + ImVec2(0.5f, 0.5f), IM_COL32(255, 255, 255, 255));
     }
 
@@ -124,8 +101,6 @@ static void tileset_selector(void)
     }
 
     global.brush.scrollToSelected = false;
-    ImGui::ItemSize(bb);
-    ImGui::ItemAdd(bb, 0);
 }
 
 void tileset_pane(void)
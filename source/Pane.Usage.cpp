@@ -0,0 +1,142 @@
+#include "Pane.Usage.h"
+#include <imgui.h>
+
+#include "AssetLoader.h"
+#include "FileDialog.h"
+#include "Global.h"
+#include "TileIndex.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+static std::string sRoot;
+static TileIndex sIndex;
+static bool sIndexed = false;
+
+static int sMode = 0; // 0: tile, 1: palette
+static int sValue = 0;
+static bool sQueryChanged = true;
+static std::vector<TileIndexHit> sHits;
+static size_t sHitMaps = 0;
+
+static void refresh_index(void)
+{
+    TileIndexStats stats;
+
+    if (const char *error = tile_index_refresh(sIndex, sRoot, stats))
+    {
+        global.statusText = error;
+        return;
+    }
+
+    sIndexed = true;
+    sQueryChanged = true;
+
+    global.statusText = "Indexed " + std::to_string(stats.maps) + " maps, " + std::to_string(stats.indexed) + " read.";
+}
+
+static void run_query(void)
+{
+    sHits.clear();
+    sHitMaps = 0;
+
+    if (sMode == 0) tile_index_find(sIndex, Mask::Index, static_cast<uint16_t>(sValue), sHits);
+    else tile_index_find(sIndex, 0xF000, static_cast<uint16_t>(sValue << 12), sHits);
+
+    for (size_t i = 0; i < sHits.size(); ++i)
+    {
+        if (i == 0 || sHits[i].map != sHits[i - 1].map)
+            ++sHitMaps;
+    }
+
+    sQueryChanged = false;
+}
+
+// Answers which maps of a project use a tile or palette, from the index that
+// ParallaxTool index maintains in the same project directory.
+void tile_usage_window(bool *open)
+{
+    if (!*open)
+        return;
+
+    ImGui::SetNextWindowSize(ImVec2(420.0f, 360.0f), ImGuiCond_FirstUseEver);
+
+    if (ImGui::Begin("Tile Usage", open))
+    {
+        if (ImGui::Button("Project..."))
+        {
+            std::string s;
+            if (FileDialog::Open(FileDialog::Mode::Folder, {}, s))
+            {
+                sRoot = s;
+                refresh_index();
+            }
+        }
+
+        ImGui::SameLine();
+        ImGui::BeginDisabled(sRoot.empty());
+        if (ImGui::Button("Refresh"))
+            refresh_index();
+        ImGui::EndDisabled();
+
+        ImGui::SameLine();
+        ImGui::TextUnformatted(sRoot.empty() ? "No project" : sRoot.c_str());
+
+        sQueryChanged |= ImGui::RadioButton("Tile", &sMode, 0);
+        ImGui::SameLine();
+        sQueryChanged |= ImGui::RadioButton("Palette", &sMode, 1);
+        ImGui::SameLine();
+
+        // Tiles are entered in hex, like the entries printed in the list.
+        static constexpr int sStep = 1, sStepFast = 16;
+        ImGui::SetNextItemWidth(120.0f * global.dpiScale);
+        if (ImGui::InputScalar("###UsageValue", ImGuiDataType_S32, &sValue, &sStep, &sStepFast, sMode == 0 ? "%03X" : "%d", sMode == 0 ? ImGuiInputTextFlags_CharsHexadecimal : 0))
+            sQueryChanged = true;
+
+        sValue = std::clamp(sValue, 0, sMode == 0 ? static_cast<int>(Mask::Index) : 15);
+
+        ImGui::SameLine();
+        if (ImGui::Button("From Brush") && !global.brush.selection.empty())
+        {
+            unsigned short entry = global.brush.selection[0];
+            sValue = sMode == 0 ? entry & Mask::Index : entry >> 12;
+            sQueryChanged = true;
+        }
+
+        if (sIndexed && sQueryChanged)
+            run_query();
+
+        if (sIndexed)
+        {
+            ImGui::Text("%zu uses in %zu of %zu maps", sHits.size(), sHitMaps, sIndex.maps.size());
+
+            // Double clicking a use opens its map in a new tab.
+            if (ImGui::BeginChild("###UsageHits", ImVec2(0.0f, 0.0f), ImGuiChildFlags_Borders))
+            {
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(sHits.size()));
+
+                while (clipper.Step())
+                {
+                    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+                    {
+                        const auto &hit = sHits[i];
+                        const auto &path = sIndex.maps[hit.map].path;
+
+                        char label[512];
+                        snprintf(label, sizeof(label), "%s  block %d  %d,%d  0x%04X###Hit%d", path.c_str(), hit.block, hit.x, hit.y, hit.entry, i);
+
+                        if (ImGui::Selectable(label, false, ImGuiSelectableFlags_AllowDoubleClick) && ImGui::IsMouseDoubleClicked(0))
+                            asset_loader_load_tilemap((std::filesystem::path(sRoot) / path).string());
+                    }
+                }
+            }
+
+            ImGui::EndChild();
+        }
+    }
+
+    ImGui::End();
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void tile_usage_window(bool *open);
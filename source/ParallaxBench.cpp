@@ -0,0 +1,689 @@
+// Microbenchmarks for the editor's hot paths. Results are printed as JSON so
+// runs from different versions can be compared by scripts.
+//
+//   parallax_bench [--filter <substring>] [--min-time <seconds>] [--out <file>]
+
+#include "ActionStack.h"
+#include "AssetCache.h"
+#include "Brush.h"
+#include "Compression.h"
+#include "File.h"
+#include "Global.h"
+#include "Importer.h"
+#include "Journal.h"
+#include "Palette.h"
+#include "Png.h"
+#include "Raster.h"
+#include "Renderer.h"
+#include "Renderer.Vertex.h"
+#include "ThreadPool.h"
+#include "TileIndex.h"
+#include "Tilemap.h"
+#include "Tilemap.IO.h"
+#include "TileOptimizer.h"
+#include "TileReplace.h"
+#include "Tileset.h"
+#include <GL/gl3w.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef PARALLAX_VERSION
+#define PARALLAX_VERSION "unknown"
+#endif
+
+struct BenchResult
+{
+    std::string name;
+    const char *unit;
+    double items;
+    int iterations;
+    double median, min, mean; // Nanoseconds per iteration
+    double ratio = 0.0; // Output over input size, for codecs
+};
+
+static std::vector<BenchResult> sResults;
+static std::string sFilter;
+static double sMinTime = 0.25;
+
+// Runs func until sMinTime has passed (at least 5 times, at most 100000).
+// items is how much work one call does, in the given unit, for throughput.
+static void bench(const char *name, const char *unit, double items, const std::function<void()> &func)
+{
+    if (!sFilter.empty() && !strstr(name, sFilter.c_str()))
+        return;
+
+    using Clock = std::chrono::steady_clock;
+
+    func();
+
+    std::vector<double> samples;
+    auto deadline = Clock::now() + std::chrono::duration<double>(sMinTime);
+
+    while (samples.size() < 5 || (Clock::now() < deadline && samples.size() < 100000))
+    {
+        auto start = Clock::now();
+        func();
+        samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+
+    double total = 0.0;
+    for (double sample : samples) total += sample;
+
+    std::sort(samples.begin(), samples.end());
+    sResults.push_back({ name, unit, items, static_cast<int>(samples.size()), samples[samples.size() / 2], samples.front(), total / samples.size() });
+
+    fprintf(stderr, "%-40s %12.0f ns  (%d runs)\n", name, samples[samples.size() / 2], static_cast<int>(samples.size()));
+}
+
+// Attaches a compression ratio to the named result, if it ran.
+static void bench_set_ratio(const std::string &name, double ratio)
+{
+    if (!sResults.empty() && sResults.back().name == name)
+        sResults.back().ratio = ratio;
+}
+
+static void random_tilemap(Tilemap &tilemap, int width, int height, std::mt19937 &rng)
+{
+    tilemap_create(tilemap, width, height);
+
+    for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x)
+        tilemap_set(tilemap, x, y, static_cast<unsigned short>(rng()));
+}
+
+// Compressible stand-ins for real assets: a map built from short runs of a
+// few dozen tiles, and a tile sheet where a third of the tiles are empty and
+// the rest repeat a small set.
+static std::vector<unsigned char> sample_tilemap_bytes(int entries, std::mt19937 &rng)
+{
+    std::vector<unsigned char> data;
+
+    while (data.size() < static_cast<size_t>(entries) * 2)
+    {
+        int run = 1 + rng() % 12;
+        unsigned int entry = (rng() % 40) | ((rng() % 3) << 12);
+
+        for (int i = 0; i < run && data.size() < static_cast<size_t>(entries) * 2; ++i)
+        {
+            data.push_back(static_cast<unsigned char>(entry));
+            data.push_back(static_cast<unsigned char>(entry >> 8));
+        }
+    }
+
+    return data;
+}
+
+static std::vector<unsigned char> sample_tile_bytes(int tiles, std::mt19937 &rng)
+{
+    std::vector<unsigned char> unique(64 * 32), data;
+    for (auto &byte : unique) byte = static_cast<unsigned char>((rng() % 4) * 0x11);
+
+    for (int t = 0; t < tiles; ++t)
+    {
+        const unsigned char *tile = unique.data() + (rng() % 64) * 32;
+
+        if (rng() % 3 == 0) data.insert(data.end(), 32, 0);
+        else data.insert(data.end(), tile, tile + 32);
+    }
+
+    return data;
+}
+
+static void random_tileset(Tileset &tileset, std::mt19937 &rng)
+{
+    for (auto &tile : tileset.tiles)
+    for (auto &pair : tile)
+        pair = static_cast<unsigned char>(rng());
+}
+
+static void bench_vertices(std::mt19937 &rng)
+{
+    static MapVertex sVertices[32 * 32 * 4];
+    std::vector<unsigned short> entries(32 * 32);
+    for (auto &entry : entries) entry = static_cast<unsigned short>(rng());
+
+    bench("map_vertex_build_tile/chunk", "tiles", 32 * 32, [&] {
+        for (int i = 0; i < 32 * 32; ++i)
+            map_vertex_build_tile(&sVertices[i * 4], i, entries[i]);
+    });
+}
+
+static void bench_palettes(const std::filesystem::path &dir, std::mt19937 &rng)
+{
+    Palette palettes[16];
+    for (auto &palette : palettes)
+    for (auto &color : palette)
+        color = { static_cast<unsigned char>(rng()), static_cast<unsigned char>(rng()), static_cast<unsigned char>(rng()) };
+
+    std::string text = palette_write_jasc(palettes[0]);
+
+    bench("palette_parse_jasc", "palettes", 1, [&] {
+        Palette out;
+        palette_parse_jasc(text.data(), text.size(), out);
+    });
+
+    auto paletteDir = dir / "palettes";
+    std::filesystem::create_directories(paletteDir);
+
+    for (int i = 0; i < 16; ++i)
+    {
+        char name[8];
+        snprintf(name, sizeof(name), "%02d.pal", i);
+        palette_save_file((paletteDir / name).string(), palettes[i]);
+    }
+
+    bench("palette_load_directory/16", "palettes", 16, [&] {
+        Palette out[16];
+        palette_load_directory(paletteDir.string(), out);
+    });
+}
+
+static void bench_tilemap_io(const std::filesystem::path &dir, std::mt19937 &rng)
+{
+    Tilemap tilemap;
+    random_tilemap(tilemap, 64, 64, rng);
+
+    std::vector<unsigned char> bytes = tilemap_write(tilemap);
+
+    bench("tilemap_write/64x64", "bytes", static_cast<double>(bytes.size()), [&] {
+        auto out = tilemap_write(tilemap);
+    });
+
+    bench("tilemap_read/64x64", "bytes", static_cast<double>(bytes.size()), [&] {
+        Tilemap out;
+        tilemap_read(out, bytes.data(), bytes.size());
+    });
+
+    auto path = (dir / "map.bin").string();
+
+    bench("tilemap_save_file/64x64", "bytes", static_cast<double>(bytes.size()), [&] {
+        tilemap_save_file(tilemap, path);
+    });
+
+    bench("tilemap_load_file/64x64", "bytes", static_cast<double>(bytes.size()), [&] {
+        Tilemap out;
+        tilemap_load_file(out, path);
+    });
+
+    // Project-sized batch: many small screenblock maps.
+    static constexpr int sFileCount = 10000;
+
+    std::vector<std::string> paths(sFileCount);
+    std::vector<Tilemap> tilemaps(sFileCount);
+    std::vector<const char *> errors;
+
+    for (int i = 0; i < sFileCount; ++i)
+    {
+        paths[i] = (dir / ("map" + std::to_string(i) + ".bin")).string();
+        random_tilemap(tilemaps[i], 32, 32, rng);
+    }
+
+    tilemap_save_files(paths, tilemaps, errors);
+
+    // Every atomic save ends in an fsync, so saving is timed on a smaller batch.
+    std::vector<std::string> savePaths(paths.begin(), paths.begin() + 1000);
+    std::vector<Tilemap> saveTilemaps(1000);
+    for (int i = 0; i < 1000; ++i)
+        random_tilemap(saveTilemaps[i], 32, 32, rng);
+
+    bench("tilemap_save_files/1k", "files", 1000, [&] {
+        tilemap_save_files(savePaths, saveTilemaps, errors);
+    });
+
+    bench("tilemap_load_files/10k", "files", sFileCount, [&] {
+        std::vector<Tilemap> out;
+        tilemap_load_files(paths, out, errors);
+    });
+
+    // The directory also holds map.bin, hence one more map than written.
+    TileIndex index;
+    TileIndexStats stats;
+
+    bench("tile_index_update/10k/full", "files", sFileCount + 1, [&] {
+        index.maps.clear();
+        tile_index_update(index, dir.string(), stats);
+    });
+
+    bench("tile_index_update/10k/unchanged", "files", sFileCount + 1, [&] {
+        tile_index_update(index, dir.string(), stats);
+    });
+
+    std::vector<TileIndexHit> hits;
+
+    bench("tile_index_find/10k/tile", "files", sFileCount + 1, [&] {
+        hits.clear();
+        tile_index_find(index, Mask::Index, 0x1A3, hits);
+    });
+
+    // A tileset renumbering: sixteen moved tiles, on one large map and then
+    // over the whole project without writing.
+    std::vector<TileReplaceRule> rules(16);
+    for (int i = 0; i < 16; ++i)
+        rules[i] = { Mask::Index, static_cast<uint16_t>(i * 37), Mask::Index, static_cast<uint16_t>(1023 - i) };
+
+    std::vector<uint16_t> entries(256 * 256), replaced;
+    for (auto &entry : entries) entry = static_cast<uint16_t>(rng());
+
+    bench("tile_replace_entries/256x256/16rules", "entries", static_cast<double>(entries.size()), [&] {
+        replaced = entries;
+        tile_replace_entries(rules, replaced.data(), replaced.size());
+    });
+
+    TileReplaceStats replaceStats;
+    std::vector<std::string> failures;
+
+    bench("tile_replace_project/10k/dry_run", "files", sFileCount + 1, [&] {
+        tile_replace_project(dir.string(), rules, true, replaceStats, failures);
+    });
+}
+
+static void bench_compression(std::mt19937 &rng)
+{
+    struct Sample { const char *name; std::vector<unsigned char> data; };
+
+    Sample samples[] = {
+        { "tilemap64x64", sample_tilemap_bytes(64 * 64, rng) },
+        { "tiles512", sample_tile_bytes(512, rng) },
+    };
+
+    for (const auto &sample : samples)
+    {
+        std::vector<unsigned char> encoded, decoded;
+
+        for (auto format : { Compression::Lz77, Compression::Rle })
+        {
+            std::string codec = format == Compression::Lz77 ? "lz77" : "rle";
+            double bytes = static_cast<double>(sample.data.size());
+
+            compression_encode(format, sample.data.data(), sample.data.size(), encoded);
+            double ratio = static_cast<double>(encoded.size()) / sample.data.size();
+
+            bench((codec + "_encode/" + sample.name).c_str(), "bytes", bytes, [&] {
+                compression_encode(format, sample.data.data(), sample.data.size(), encoded);
+            });
+            bench_set_ratio(codec + "_encode/" + sample.name, ratio);
+
+            bench((codec + "_decode/" + sample.name).c_str(), "bytes", bytes, [&] {
+                compression_decode(encoded.data(), encoded.size(), decoded);
+            });
+            bench_set_ratio(codec + "_decode/" + sample.name, ratio);
+        }
+    }
+}
+
+static void bench_editing(std::mt19937 &rng)
+{
+    static constexpr int sStrokes = 1000, sStrokeTiles = 64;
+
+    Document doc;
+    tilemap_create(doc.tilemap, 256, 256);
+    global.document = &doc;
+
+    std::vector<unsigned int> cells(sStrokes * sStrokeTiles);
+    for (auto &cell : cells) cell = rng() % (256 * 256);
+
+    bench("action_stack_record/1000x64", "deltas", sStrokes * sStrokeTiles, [&] {
+        action_stack_clear();
+
+        for (int s = 0; s < sStrokes; ++s)
+        {
+            for (int i = 0; i < sStrokeTiles; ++i)
+                action_stack_record(cells[s * sStrokeTiles + i], 0, static_cast<unsigned short>(s + 1));
+
+            action_stack_end_stroke();
+        }
+    });
+
+    bench("action_stack_undo_redo/1000x64", "strokes", sStrokes * 2, [&] {
+        for (int s = 0; s < sStrokes; ++s) action_stack_do_undo();
+        for (int s = 0; s < sStrokes; ++s) action_stack_do_redo();
+    });
+
+    action_stack_clear();
+
+    Brush brush;
+    brush.width = brush.height = 4;
+    brush.fromTileset = false;
+    brush.selection.resize(16);
+
+    int counter = 0;
+
+    bench("brush_stamp/4x4x1000", "tiles", 16 * 1000, [&] {
+        for (int i = 0; i < 1000; ++i)
+        {
+            for (auto &tile : brush.selection) tile = static_cast<unsigned short>(++counter);
+            brush_stamp(brush, doc.tilemap, (i * 7) % 252, (i * 13) % 252);
+        }
+
+        action_stack_end_stroke();
+    });
+
+    // The same strokes with the reverse index attached, which tilemap_set
+    // then keeps up to date.
+    tilemap_usage(doc.tilemap);
+
+    bench("brush_stamp/4x4x1000/usage", "tiles", 16 * 1000, [&] {
+        for (int i = 0; i < 1000; ++i)
+        {
+            for (auto &tile : brush.selection) tile = static_cast<unsigned short>(++counter);
+            brush_stamp(brush, doc.tilemap, (i * 7) % 252, (i * 13) % 252);
+        }
+
+        action_stack_end_stroke();
+    });
+
+    action_stack_clear();
+    global.document = nullptr;
+
+    Tilemap tilemap;
+    random_tilemap(tilemap, 1024, 1024, rng);
+
+    bench("tile_usage_build/1024x1024", "tiles", 1024 * 1024, [&] {
+        TileUsage usage;
+        tile_usage_build(usage, tilemap);
+    });
+}
+
+// Autosave cost of one brush stroke: appending it to the journal versus
+// rewriting the whole map.
+static void bench_journal(const std::filesystem::path &dir, std::mt19937 &rng)
+{
+    static constexpr int sStrokeTiles = 64;
+
+    Tilemap tilemap;
+    random_tilemap(tilemap, 256, 256, rng);
+
+    auto path = (dir / "journal.bin").string();
+
+    JournalState state;
+    journal_base(tilemap, state);
+
+    Journal journal;
+    journal_attach(journal, path, state);
+
+    std::vector<TileDelta> stroke(sStrokeTiles);
+    unsigned int cell = rng() % (256 * 256 - 4 * sStrokeTiles);
+
+    for (auto &delta : stroke)
+    {
+        cell += 1 + rng() % 4;
+        delta = { cell, static_cast<unsigned short>(rng()), static_cast<unsigned short>(rng()) };
+    }
+
+    bench("journal_append/stroke64", "deltas", sStrokeTiles, [&] {
+        journal_append(journal, stroke.data(), stroke.size(), false);
+    });
+
+    journal_close(journal);
+
+    std::vector<unsigned char> bytes = tilemap_write(tilemap);
+
+    bench("tilemap_save_file/256x256", "bytes", static_cast<double>(bytes.size()), [&] {
+        tilemap_save_file(tilemap, path);
+    });
+
+    bench("journal_hash/256x256", "tiles", 256 * 256, [&] {
+        journal_hash(tilemap);
+    });
+}
+
+static void bench_raster(std::mt19937 &rng)
+{
+    static Tileset sTileset;
+    static RasterTiles sTiles;
+    static RasterPalettes sPalettes;
+
+    random_tileset(sTileset, rng);
+    raster_prepare_tiles(sTileset, sTiles);
+    raster_reset_palettes(sPalettes);
+
+    std::vector<unsigned short> entries(32 * 32);
+    for (auto &entry : entries) entry = static_cast<unsigned short>(rng());
+
+    std::vector<uint32_t> pixels(256 * 256);
+
+    bench("raster_render_rgba/256x256", "pixels", 256 * 256, [&] {
+        raster_render_rgba(entries.data(), 32, 32, 32, sTiles, sPalettes, pixels.data(), 256);
+    });
+
+    bench("raster_prepare_tiles", "tiles", Tileset::TileCount, [&] {
+        raster_prepare_tiles(sTileset, sTiles);
+    });
+
+    Tilemap tilemap;
+    random_tilemap(tilemap, 64, 64, rng);
+
+    bench("raster_render_map/64x64", "tiles", 64 * 64, [&] {
+        IndexedImage image;
+        raster_render_map(tilemap, sTileset, image);
+    });
+}
+
+static void bench_tiles(const std::filesystem::path &dir, std::mt19937 &rng)
+{
+    // A sheet where most tiles are flipped copies of 128 originals.
+    static Tileset sSource;
+    random_tileset(sSource, rng);
+
+    for (int t = 128; t < Tileset::TileCount; ++t)
+    {
+        int from = rng() % 128, flip = rng() % 4;
+        unsigned char pixels[64];
+
+        for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 8; ++x)
+            pixels[x + y * 8] = static_cast<unsigned char>(tileset_pixel(sSource.tiles[from], flip & 1 ? 7 - x : x, flip & 2 ? 7 - y : y));
+
+        tileset_pack_tile(pixels, sSource.tiles[t]);
+    }
+
+    Tilemap source;
+    random_tilemap(source, 64, 64, rng);
+
+    bench("tile_optimizer/1024+64x64", "tiles", Tileset::TileCount, [&] {
+        static Tileset sTileset;
+        sTileset = sSource;
+
+        Tilemap tilemap;
+        tilemap_create(tilemap, 64, 64);
+        for (size_t c = 0; c < source.chunks.size(); ++c)
+            tilemap.chunks[c] = std::make_unique<TilemapChunk>(*source.chunks[c]);
+
+        TileRemap remap;
+        tile_optimizer_run(sTileset, remap);
+        tile_optimizer_remap(tilemap, remap);
+    });
+
+    // 256x256 image built from a few hundred tiles in 8 palettes.
+    std::vector<unsigned char> rgb(256 * 256 * 3);
+    for (int ty = 0; ty < 32; ++ty)
+    for (int tx = 0; tx < 32; ++tx)
+    {
+        int tile = rng() % 300, palette = tile % 8;
+
+        for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 8; ++x)
+        {
+            int color = tileset_pixel(sSource.tiles[tile], x, y) % 8;
+            unsigned char *px = &rgb[((ty * 8 + y) * 256 + tx * 8 + x) * 3];
+            px[0] = static_cast<unsigned char>(palette * 32);
+            px[1] = static_cast<unsigned char>(color * 32);
+            px[2] = static_cast<unsigned char>((palette + color) * 16);
+        }
+    }
+
+    bench("import_image_pixels/256x256", "pixels", 256 * 256, [&] {
+        auto result = std::make_unique<ImportResult>();
+        import_image_pixels(rgb.data(), 256, 256, *result);
+    });
+
+    // Loading a sheet: raw tile data is a bulk copy, a PNG needs decoding
+    // and packing.
+    auto sheet = std::make_unique<TileSheet>();
+    tileset_store_sheet(sSource, false, *sheet);
+
+    for (const char *name : { "tiles.4bpp", "tiles.png" })
+    {
+        auto path = (dir / name).string();
+        tileset_save_sheet(path, *sheet);
+
+        bench((std::string("tileset_decode_sheet/") + name).c_str(), "tiles", Tileset::SheetTiles, [&] {
+            tileset_decode_sheet(path, *sheet);
+            tileset_load_sheet(sSource, *sheet, false);
+        });
+    }
+}
+
+// Full redraw of every chunk of a 64x64 map, per map backend. Needs a GL 3.3
+// context; skipped on machines without one.
+static bool bench_frame(std::mt19937 &rng)
+{
+    if (!glfwInit())
+        return false;
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow *window = glfwCreateWindow(64, 64, "parallax_bench", nullptr, nullptr);
+    if (!window)
+    {
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    if (gl3wInit() != 0)
+    {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return false;
+    }
+
+    auto &r = global.renderer;
+    renderer_init(r);
+
+    Tileset tileset;
+    random_tileset(tileset, rng);
+
+    static const Palette sPalettes[16] = {};
+    auto tilesetAsset = asset_cache_tileset(r, tileset);
+    auto paletteAsset = asset_cache_palettes(r, sPalettes, 0xFFFF);
+    renderer_bind_assets(r, *tilesetAsset, *paletteAsset);
+
+    // A second document on the same tileset only costs the hash and compare.
+    bench("asset_cache_tileset/hit", "tilesets", 1, [&] {
+        auto ref = asset_cache_tileset(r, tileset);
+    });
+
+    Tilemap tilemap;
+    MapView view;
+    random_tilemap(tilemap, 64, 64, rng);
+    renderer_set_map_view(view, 0, 0, tilemap.chunksX, tilemap.chunksY);
+
+    struct Variant { const char *name; RendererBackend backend; MapPipeline pipeline; };
+    static constexpr Variant sVariants[] = {
+        { "frame_map/64x64/vertex", RendererBackend::OpenGL, MapPipeline::Vertex },
+        { "frame_map/64x64/texture", RendererBackend::OpenGL, MapPipeline::Texture },
+        { "frame_map/64x64/software", RendererBackend::Software, MapPipeline::Texture },
+    };
+
+    for (const auto &variant : sVariants)
+    {
+        renderer_set_backend(r, variant.backend);
+        renderer_set_map_pipeline(r, variant.pipeline);
+
+        bench(variant.name, "tiles", 64 * 64, [&] {
+            renderer_invalidate_map(view);
+            renderer_call(r, view, tilemap);
+            glFinish();
+        });
+    }
+
+    renderer_release_map(view);
+    tilesetAsset.reset();
+    paletteAsset.reset();
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return true;
+}
+
+static void write_json(FILE *out, bool gl)
+{
+    fprintf(out, "{\n  \"version\": \"%s\",\n  \"raster_kernel\": \"%s\",\n  \"threads\": %zu,\n  \"gl\": %s,\n  \"results\": [",
+            PARALLAX_VERSION, raster_kernel_name(), thread_pool_size() + 1, gl ? "true" : "false");
+
+    for (size_t i = 0; i < sResults.size(); ++i)
+    {
+        const auto &result = sResults[i];
+        double perSecond = result.median > 0.0 ? result.items / (result.median * 1e-9) : 0.0;
+
+        fprintf(out, "%s\n    { \"name\": \"%s\", \"iterations\": %d, \"median_ns\": %.1f, \"min_ns\": %.1f, \"mean_ns\": %.1f, \"unit\": \"%s\", \"per_second\": %.1f",
+                i ? "," : "", result.name.c_str(), result.iterations, result.median, result.min, result.mean, result.unit, perSecond);
+
+        if (result.ratio > 0.0)
+            fprintf(out, ", \"ratio\": %.4f", result.ratio);
+
+        fprintf(out, " }");
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *outPath = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) sFilter = argv[++i];
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) sMinTime = atof(argv[++i]);
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) outPath = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: parallax_bench [--filter <substring>] [--min-time <seconds>] [--out <file>]\n");
+            return 2;
+        }
+    }
+
+    auto dir = std::filesystem::temp_directory_path() / ("parallax_bench_" + std::to_string(std::random_device()()));
+    std::filesystem::create_directories(dir);
+
+    std::mt19937 rng(1234);
+
+    bench_vertices(rng);
+    bench_palettes(dir, rng);
+    bench_tilemap_io(dir, rng);
+    bench_compression(rng);
+    bench_editing(rng);
+    bench_journal(dir, rng);
+    bench_raster(rng);
+    bench_tiles(dir, rng);
+    bool gl = bench_frame(rng);
+
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+
+    FILE *out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Could not open %s.\n", outPath);
+        return 1;
+    }
+
+    write_json(out, gl);
+    if (outPath) fclose(out);
+
+    return 0;
+}
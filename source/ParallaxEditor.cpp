@@ -14,8 +14,15 @@
 #include "Utils.h"
 #include "Pane.Map.h"
 #include "Pane.Picker.h"
+#include "Pane.Find.h"
+#include "Pane.Usage.h"
 #include "MenuBar.h"
 #include "Shortcut.h"
+#include "Scheduler.h"
+#include "AssetLoader.h"
+#include "Profiler.h"
+
+#include <cstring>
 
 void load_tilemap_from_file(const std::string &fname);
 void load_secondary_tileset(const std::string &fname);
@@ -54,6 +61,17 @@ void status_bar(void)
             ImGui::EndMenu();
         }
 
+        int done, total;
+        if (asset_loader_progress(done, total))
+        {
+            char progressLabel[32];
+            snprintf(progressLabel, sizeof(progressLabel), "Loading %i/%i", done, total);
+            ImGui::ProgressBar(static_cast<float>(done) / total, ImVec2(160.0f * global.dpiScale, 0.0f), progressLabel);
+        }
+
+        if (!global.statusText.empty())
+            ImGui::TextUnformatted(global.statusText.c_str());
+
         ImGui::EndMenuBar();
     }
 
@@ -85,15 +103,26 @@ int main(int argc, char *argv[])
     glfwShowWindow(window);
 
     glfwSetKeyCallback(window, [](GLFWwindow* window, int k, int, int a, int m) {
+        scheduler_invalidate();
         shortcut_callback(k, m, a);
     });
 
+    scheduler_init(window);
+
     ASSERT(gl3wInit() != -1, "GL3W could not be initialized.");
 
     FileDialog::Init(window);
 
     renderer_init(global.renderer);
 
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--software") == 0)
+            renderer_set_backend(global.renderer, RendererBackend::Software);
+    }
+
+    document_create();
+
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGui::StyleColorsDark();
@@ -109,12 +138,25 @@ int main(int argc, char *argv[])
     // load_palettes("palettes");
     // load_tilemap_from_file("tamarok.bin");
 
-    while (!glfwWindowShouldClose(window))
+    while (scheduler_wait_for_frame())
     {
+        profiler_begin_frame();
+
         glClearColor(0.0, 0.0, 0.0, 1.0);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        renderer_call(global.renderer, global.tilemap);
+        {
+            PROFILE_SCOPE("asset_loader_poll");
+            asset_loader_poll();
+        }
+
+        document_sync_journals();
+
+        {
+            auto &doc = *global.document;
+            renderer_bind_assets(global.renderer, *doc.tileset, *doc.palettes);
+            renderer_call(global.renderer, doc.view, doc.tilemap);
+        }
 
         {
             ImGui_ImplOpenGL3_NewFrame();
@@ -129,24 +171,47 @@ int main(int argc, char *argv[])
                 static constexpr ImGuiWindowFlags sWindowFlags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoNavFocus | ImGuiWindowFlags_NoBringToFrontOnFocus | ImGuiWindowFlags_NoCollapse;
                 ImGui::Begin("###ParallaxEditor", NULL, sWindowFlags | ImGuiWindowFlags_MenuBar);
 
-                main_menu_bar();
-                tileset_pane(); ImGui::SameLine();
-                tilemap_pane();
+                {
+                    PROFILE_SCOPE("main_menu_bar");
+                    main_menu_bar();
+                }
+
+                {
+                    PROFILE_SCOPE("tileset_pane");
+                    tileset_pane(); ImGui::SameLine();
+                }
+
+                {
+                    PROFILE_SCOPE("tilemap_pane");
+                    tilemap_pane();
+                }
 
                 ImGui::End();
 
                 status_bar();
+                tile_usage_window(&global.showTileUsage);
+                find_tile_window(&global.showFindTile);
+                profiler_window(&global.showProfiler);
             }
 
             int displayW, displayH;
             ImGui::Render();
             glfwGetFramebufferSize(window, &displayW, &displayH);
             glViewport(0, 0, displayW, displayH);
+
+            PROFILE_GPU_SCOPE("ImGui_ImplOpenGL3_RenderDrawData");
             ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        {
+            PROFILE_SCOPE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
+
+        profiler_end_frame();
+        scheduler_end_frame();
     }
+
+    document_close_all();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,385 @@
+// Command line front end for work that needs no window or GPU, such as
+// regenerating map previews on build servers.
+
+#include "Compression.h"
+#include "File.h"
+#include "Palette.h"
+#include "Png.h"
+#include "Raster.h"
+#include "ThreadPool.h"
+#include "TileIndex.h"
+#include "Tilemap.h"
+#include "Tilemap.IO.h"
+#include "TileReplace.h"
+#include "Tileset.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct RenderJob
+{
+    std::string tilemap, primary, secondary, palettes, output;
+};
+
+// One job per line: tilemap primary.png secondary.png palette-dir output.png
+// Use "-" for a missing secondary tileset. Blank lines and lines starting
+// with '#' are skipped.
+static bool parse_render_jobs(const std::string &path, std::vector<RenderJob> &jobs)
+{
+    MappedFile file;
+    if (!file_map(file, path))
+        return false;
+
+    std::string_view text(reinterpret_cast<const char *>(file.data), file.size);
+
+    while (!text.empty())
+    {
+        size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        text = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+
+        std::vector<std::string> fields;
+
+        for (size_t pos = 0; pos < line.size();)
+        {
+            pos = line.find_first_not_of(" \t\r", pos);
+            if (pos == std::string_view::npos) break;
+
+            size_t stop = std::min(line.find_first_of(" \t\r", pos), line.size());
+            fields.emplace_back(line.substr(pos, stop - pos));
+            pos = stop;
+        }
+
+        if (fields.empty() || fields[0][0] == '#')
+            continue;
+
+        if (fields.size() != 5)
+        {
+            fprintf(stderr, "%s: expected 5 fields, got %zu: %.*s\n", path.c_str(), fields.size(), static_cast<int>(line.size()), line.data());
+            return false;
+        }
+
+        jobs.push_back({ fields[0], fields[1], fields[2] == "-" ? std::string() : fields[2], fields[3], fields[4] });
+    }
+
+    return true;
+}
+
+static const char *run_render_job(const RenderJob &job)
+{
+    Tilemap tilemap;
+    if (const char *error = tilemap_load_file(tilemap, job.tilemap))
+        return error;
+
+    auto tileset = std::make_unique<Tileset>();
+
+    for (int sheet = 0; sheet < 2; ++sheet)
+    {
+        const std::string &path = sheet ? job.secondary : job.primary;
+        if (path.empty()) continue;
+
+        auto tiles = std::make_unique<TileSheet>();
+        if (const char *error = tileset_decode_sheet(path, *tiles))
+            return error;
+
+        tileset_load_sheet(*tileset, *tiles, sheet == 1);
+    }
+
+    Palette palettes[16]{};
+    const char *error = nullptr;
+    palette_load_directory(job.palettes, palettes, &error);
+
+    if (error)
+        return error;
+
+    IndexedImage image;
+    raster_render_map(tilemap, *tileset, image);
+    image.palette = raster_palette_table(palettes);
+
+    return png_save_indexed(job.output, image);
+}
+
+static int command_render(int argc, char **argv)
+{
+    if (argc != 1)
+        return -1;
+
+    std::vector<RenderJob> jobs;
+    if (!parse_render_jobs(argv[0], jobs))
+    {
+        fprintf(stderr, "Could not read job file %s.\n", argv[0]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Jobs are independent, so they spread over every core of the pool.
+    std::vector<const char *> errors(jobs.size());
+    thread_pool_parallel_for(jobs.size(), [&](size_t i) {
+        errors[i] = run_render_job(jobs[i]);
+    });
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    size_t failed = 0;
+
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        if (!errors[i]) continue;
+
+        fprintf(stderr, "%s: %s\n", jobs[i].output.c_str(), errors[i]);
+        ++failed;
+    }
+
+    printf("Rendered %zu of %zu maps in %.1f ms on %zu threads.\n", jobs.size() - failed, jobs.size(), ms, thread_pool_size() + 1);
+    return failed ? 1 : 0;
+}
+
+static int command_index(int argc, char **argv)
+{
+    if (argc != 1)
+        return -1;
+
+    auto start = std::chrono::steady_clock::now();
+
+    TileIndex index;
+    TileIndexStats stats;
+    if (const char *error = tile_index_refresh(index, argv[0], stats))
+    {
+        fprintf(stderr, "%s: %s\n", argv[0], error);
+        return 1;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("Indexed %zu maps (%zu read, %zu removed) in %.1f ms.\n", stats.maps, stats.indexed, stats.removed, ms);
+    return 0;
+}
+
+// where <project-dir> tile|palette <n>, where n may be hex, e.g. 0x1A3.
+// Prints each use as <map>:<screenblock>:<x>,<y> <entry>, see TileIndexHit.
+static int command_where(int argc, char **argv)
+{
+    if (argc != 3)
+        return -1;
+
+    char *end;
+    long value = strtol(argv[2], &end, 0);
+    if (*end != '\0' || value < 0)
+        return -1;
+
+    uint16_t mask;
+    if (strcmp(argv[1], "tile") == 0 && value <= Mask::Index) mask = Mask::Index;
+    else if (strcmp(argv[1], "palette") == 0 && value < 16) { mask = 0xF000; value <<= 12; }
+    else return -1;
+
+    // Refreshing first only re-reads maps that changed since the last run.
+    TileIndex index;
+    TileIndexStats stats;
+    if (const char *error = tile_index_refresh(index, argv[0], stats))
+    {
+        fprintf(stderr, "%s: %s\n", argv[0], error);
+        return 1;
+    }
+
+    std::vector<TileIndexHit> hits;
+    tile_index_find(index, mask, static_cast<uint16_t>(value), hits);
+
+    size_t maps = 0;
+
+    for (size_t i = 0; i < hits.size(); ++i)
+    {
+        const auto &hit = hits[i];
+        if (i == 0 || hit.map != hits[i - 1].map) ++maps;
+
+        printf("%s:%d:%d,%d 0x%04X\n", index.maps[hit.map].path.c_str(), hit.block, hit.x, hit.y, hit.entry);
+    }
+
+    printf("%zu uses in %zu of %zu maps.\n", hits.size(), maps, index.maps.size());
+    return 0;
+}
+
+// replace <project-dir> <rules.txt> [--dry-run], see TileReplace.h for the
+// rule format. Empty cells, entry 0, are never rewritten.
+static int command_replace(int argc, char **argv)
+{
+    if (argc != 2 && !(argc == 3 && strcmp(argv[2], "--dry-run") == 0))
+        return -1;
+
+    bool dryRun = argc == 3;
+
+    std::vector<TileReplaceRule> rules;
+    size_t line;
+    if (const char *error = tile_replace_load(argv[1], rules, line))
+    {
+        if (line) fprintf(stderr, "%s:%zu: %s\n", argv[1], line, error);
+        else fprintf(stderr, "%s: %s\n", argv[1], error);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    TileReplaceStats stats;
+    std::vector<std::string> failures;
+    if (const char *error = tile_replace_project(argv[0], rules, dryRun, stats, failures))
+    {
+        fprintf(stderr, "%s: %s\n", argv[0], error);
+        return 1;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    for (const auto &failure : failures)
+        fprintf(stderr, "%s\n", failure.c_str());
+
+    printf("%s %zu entries in %zu of %zu maps in %.1f ms (%s).\n", dryRun ? "Would rewrite" : "Rewrote",
+           stats.entries, stats.changed, stats.maps, ms, tile_replace_kernel_name());
+    return stats.failed ? 1 : 0;
+}
+
+static const char *compress_file(const std::string &path, Compression format, size_t &inSize, size_t &outSize)
+{
+    MappedFile file;
+    if (!file_map(file, path))
+        return "Could not open file.";
+
+    std::vector<unsigned char> encoded;
+    if (const char *error = compression_encode(format, file.data, file.size, encoded))
+        return error;
+
+    inSize = file.size;
+    outSize = encoded.size();
+
+    const char *ext = format == Compression::Lz77 ? ".lz" : ".rl";
+    return file_write_atomic(path + ext, encoded.data(), encoded.size()) ? nullptr : "Could not write file.";
+}
+
+static const char *decompress_file(const std::string &path, size_t &inSize, size_t &outSize)
+{
+    if (compression_from_path(path) == Compression::None)
+        return "Expected a .lz or .rl file.";
+
+    std::vector<unsigned char> decoded;
+    if (const char *error = compression_load_file(path, decoded))
+        return error;
+
+    std::error_code ec;
+    inSize = std::filesystem::file_size(path, ec);
+    outSize = decoded.size();
+
+    auto output = std::filesystem::path(path).replace_extension().string();
+    return file_write_atomic(output, decoded.data(), decoded.size()) ? nullptr : "Could not write file.";
+}
+
+// compress lz|rl <file>... writes <file>.lz or <file>.rl next to each input,
+// decompress <file>... writes each without its .lz or .rl extension. Files
+// are processed in parallel.
+static int command_codec(int argc, char **argv, bool compress)
+{
+    Compression format = Compression::None;
+
+    if (compress)
+    {
+        if (argc < 1) return -1;
+        if (strcmp(argv[0], "lz") == 0) format = Compression::Lz77;
+        else if (strcmp(argv[0], "rl") == 0) format = Compression::Rle;
+        else return -1;
+
+        --argc;
+        ++argv;
+    }
+
+    if (argc < 1)
+        return -1;
+
+    std::vector<std::string> paths(argv, argv + argc);
+    std::vector<const char *> errors(paths.size());
+    std::vector<size_t> inSizes(paths.size()), outSizes(paths.size());
+
+    auto start = std::chrono::steady_clock::now();
+
+    thread_pool_parallel_for(paths.size(), [&](size_t i) {
+        errors[i] = compress ? compress_file(paths[i], format, inSizes[i], outSizes[i]) : decompress_file(paths[i], inSizes[i], outSizes[i]);
+    });
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    size_t failed = 0, in = 0, out = 0;
+
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (errors[i])
+        {
+            fprintf(stderr, "%s: %s\n", paths[i].c_str(), errors[i]);
+            ++failed;
+            continue;
+        }
+
+        in += inSizes[i];
+        out += outSizes[i];
+    }
+
+    // Throughput is measured on the uncompressed side either way.
+    size_t raw = compress ? in : out, packed = compress ? out : in;
+    printf("%s %zu of %zu files, %zu -> %zu bytes (%.1f%%) in %.1f ms, %.1f MB/s.\n", compress ? "Compressed" : "Decompressed",
+           paths.size() - failed, paths.size(), in, out, raw ? 100.0 * packed / raw : 0.0, ms, ms > 0.0 ? raw / (ms * 1e3) : 0.0);
+    return failed ? 1 : 0;
+}
+
+static int command_compress(int argc, char **argv) { return command_codec(argc, argv, true); }
+static int command_decompress(int argc, char **argv) { return command_codec(argc, argv, false); }
+
+struct Command
+{
+    const char *name;
+    const char *usage;
+    int (*run)(int argc, char **argv);
+};
+
+static constexpr Command sCommands[] = {
+    { "render", "render <jobs.txt>", command_render },
+    { "index", "index <project-dir>", command_index },
+    { "where", "where <project-dir> tile|palette <n>", command_where },
+    { "replace", "replace <project-dir> <rules.txt> [--dry-run]", command_replace },
+    { "compress", "compress lz|rl <file>...", command_compress },
+    { "decompress", "decompress <file.lz|file.rl>...", command_decompress },
+};
+
+static void print_usage(void)
+{
+    fprintf(stderr, "Usage:\n");
+    for (const auto &command : sCommands)
+        fprintf(stderr, "  ParallaxTool %s\n", command.usage);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        print_usage();
+        return 2;
+    }
+
+    for (const auto &command : sCommands)
+    {
+        if (strcmp(argv[1], command.name) != 0)
+            continue;
+
+        // Commands return -1 for bad arguments.
+        int result = command.run(argc - 2, argv + 2);
+        if (result < 0)
+        {
+            fprintf(stderr, "Usage: ParallaxTool %s\n", command.usage);
+            return 2;
+        }
+
+        return result;
+    }
+
+    print_usage();
+    return 2;
+}
@@ -0,0 +1,304 @@
+#include "Png.h"
+#include "File.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+static constexpr unsigned char sPngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+static unsigned int read_u32(const unsigned char *p)
+{
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void write_u32(std::vector<unsigned char> &out, unsigned int value)
+{
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static unsigned int crc32(const unsigned char *data, size_t size)
+{
+    static const auto sTable = [] {
+        std::array<unsigned int, 256> table{};
+
+        for (unsigned int i = 0; i < 256; ++i)
+        {
+            unsigned int c = i;
+            for (int k = 0; k < 8; ++k)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+
+        return table;
+    }();
+
+    unsigned int crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i)
+        crc = sTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static void write_chunk(std::vector<unsigned char> &out, const char *type, const unsigned char *body, size_t length)
+{
+    write_u32(out, static_cast<unsigned int>(length));
+
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (length) out.insert(out.end(), body, body + length);
+
+    write_u32(out, crc32(out.data() + start, length + 4));
+}
+
+static unsigned char paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+// Reverses the per-row filters in place. Indexed and gray images with at
+// most 8 bits per sample always filter against the previous byte.
+static bool unfilter(unsigned char *data, size_t stride, int height)
+{
+    unsigned char *prev = nullptr;
+
+    for (int y = 0; y < height; ++y)
+    {
+        unsigned char filter = data[0];
+        unsigned char *row = data + 1;
+
+        for (size_t x = 0; x < stride; ++x)
+        {
+            int a = x > 0 ? row[x - 1] : 0;
+            int b = prev ? prev[x] : 0;
+            int c = x > 0 && prev ? prev[x - 1] : 0;
+
+            switch (filter)
+            {
+            case 0: break;
+            case 1: row[x] += a; break;
+            case 2: row[x] += b; break;
+            case 3: row[x] += (a + b) / 2; break;
+            case 4: row[x] += paeth(a, b, c); break;
+            default: return false;
+            }
+        }
+
+        prev = row;
+        data += stride + 1;
+    }
+
+    return true;
+}
+
+const char *png_decode_indexed(const unsigned char *data, size_t size, IndexedImage &out, bool flipVertically)
+{
+    if (size < 8 || memcmp(data, sPngSignature, 8) != 0)
+        return "Not a PNG file.";
+
+    int width = 0, height = 0, depth = 0, colorType = -1;
+    std::vector<unsigned char> compressed, palette;
+
+    for (size_t pos = 8; pos + 12 <= size;)
+    {
+        unsigned int length = read_u32(data + pos);
+        const unsigned char *type = data + pos + 4;
+        const unsigned char *body = data + pos + 8;
+
+        if (length > size - pos - 12)
+            return "Truncated PNG chunk.";
+
+        if (memcmp(type, "IHDR", 4) == 0)
+        {
+            if (length < 13)
+                return "Invalid PNG header.";
+
+            width = read_u32(body);
+            height = read_u32(body + 4);
+            depth = body[8];
+            colorType = body[9];
+
+            if (body[12] != 0)
+                return "Interlaced PNGs are not supported.";
+        }
+        else if (memcmp(type, "PLTE", 4) == 0)
+        {
+            palette.assign(body, body + length);
+        }
+        else if (memcmp(type, "IDAT", 4) == 0)
+        {
+            compressed.insert(compressed.end(), body, body + length);
+        }
+        else if (memcmp(type, "IEND", 4) == 0)
+        {
+            break;
+        }
+
+        pos += length + 12;
+    }
+
+    if (colorType != 0 && colorType != 3)
+        return "Tileset must be an indexed (palettized) or grayscale PNG.";
+
+    if (depth != 1 && depth != 2 && depth != 4 && depth != 8)
+        return "Unsupported PNG bit depth.";
+
+    if (width <= 0 || height <= 0 || width > 16384 || height > 16384)
+        return "Invalid PNG dimensions.";
+
+    if (compressed.empty())
+        return "PNG has no image data.";
+
+    size_t stride = (static_cast<size_t>(width) * depth + 7) / 8;
+    size_t expected = (stride + 1) * height;
+
+    int inflatedSize = 0;
+    std::unique_ptr<unsigned char, decltype(&free)> inflated(
+        reinterpret_cast<unsigned char *>(stbi_zlib_decode_malloc_guesssize_headerflag(
+            reinterpret_cast<const char *>(compressed.data()), static_cast<int>(compressed.size()), static_cast<int>(expected), &inflatedSize, 1)),
+        &free);
+
+    if (!inflated || static_cast<size_t>(inflatedSize) < expected)
+        return "Corrupt PNG image data.";
+
+    if (!unfilter(inflated.get(), stride, height))
+        return "Corrupt PNG filter data.";
+
+    out.width = width;
+    out.height = height;
+    out.pixels.resize(static_cast<size_t>(width) * height);
+    out.palette = colorType == 3 ? std::move(palette) : std::vector<unsigned char>();
+
+    int perByte = 8 / depth;
+    unsigned char mask = static_cast<unsigned char>((1 << depth) - 1);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char *src = inflated.get() + y * (stride + 1) + 1;
+        unsigned char *dst = out.pixels.data() + static_cast<size_t>(flipVertically ? height - 1 - y : y) * width;
+
+        if (depth == 8)
+        {
+            memcpy(dst, src, width);
+            continue;
+        }
+
+        for (int x = 0; x < width; ++x)
+        {
+            int shift = 8 - depth * (x % perByte + 1);
+            dst[x] = (src[x / perByte] >> shift) & mask;
+        }
+    }
+
+    return nullptr;
+}
+
+// Writes a 4bpp image when every index fits, 8bpp otherwise. Rows are left
+// unfiltered and the zlib stream uses stored blocks: tilesets are small, and
+// the encoder only has to produce something every other tool can read.
+const char *png_encode_indexed(const IndexedImage &image, std::vector<unsigned char> &out)
+{
+    if (image.width <= 0 || image.height <= 0 || image.pixels.size() < static_cast<size_t>(image.width) * image.height)
+        return "Invalid image.";
+
+    bool indexed = !image.palette.empty();
+    int depth = std::all_of(image.pixels.begin(), image.pixels.end(), [](unsigned char p) { return p < 16; }) ? 4 : 8;
+
+    size_t stride = (static_cast<size_t>(image.width) * depth + 7) / 8;
+
+    std::vector<unsigned char> raw((stride + 1) * image.height, 0);
+
+    for (int y = 0; y < image.height; ++y)
+    {
+        const unsigned char *src = image.pixels.data() + static_cast<size_t>(y) * image.width;
+        unsigned char *dst = raw.data() + y * (stride + 1) + 1;
+
+        if (depth == 8)
+        {
+            memcpy(dst, src, image.width);
+            continue;
+        }
+
+        for (int x = 0; x < image.width; ++x)
+            dst[x / 2] |= src[x] << (x % 2 ? 0 : 4);
+    }
+
+    std::vector<unsigned char> zlib = { 0x78, 0x01 };
+    unsigned int adlerA = 1, adlerB = 0;
+
+    for (size_t pos = 0;;)
+    {
+        size_t length = std::min<size_t>(raw.size() - pos, 0xFFFF);
+        bool last = pos + length == raw.size();
+
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(length & 0xFF);
+        zlib.push_back(length >> 8);
+        zlib.push_back(~length & 0xFF);
+        zlib.push_back((~length >> 8) & 0xFF);
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + length);
+
+        for (size_t i = pos; i < pos + length; ++i)
+        {
+            adlerA = (adlerA + raw[i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+
+        pos += length;
+        if (last) break;
+    }
+
+    write_u32(zlib, (adlerB << 16) | adlerA);
+
+    unsigned char header[13] = {};
+    header[0] = image.width >> 24; header[1] = image.width >> 16; header[2] = image.width >> 8; header[3] = image.width;
+    header[4] = image.height >> 24; header[5] = image.height >> 16; header[6] = image.height >> 8; header[7] = image.height;
+    header[8] = depth;
+    header[9] = indexed ? 3 : 0;
+
+    out.assign(sPngSignature, sPngSignature + 8);
+    write_chunk(out, "IHDR", header, sizeof(header));
+
+    if (indexed)
+        write_chunk(out, "PLTE", image.palette.data(), std::min<size_t>(image.palette.size(), (size_t(1) << depth) * 3) / 3 * 3);
+
+    write_chunk(out, "IDAT", zlib.data(), zlib.size());
+    write_chunk(out, "IEND", nullptr, 0);
+
+    return nullptr;
+}
+
+const char *png_save_indexed(const std::string &path, const IndexedImage &image)
+{
+    std::vector<unsigned char> data;
+
+    if (const char *error = png_encode_indexed(image, data))
+        return error;
+
+    if (!file_write_atomic(path, data.data(), data.size()))
+        return "Could not write image file.";
+
+    return nullptr;
+}
+
+const char *png_load_indexed(const std::string &path, IndexedImage &out, bool flipVertically)
+{
+    MappedFile file;
+
+    if (!file_map(file, path))
+        return "Could not open image file.";
+
+    return png_decode_indexed(file.data, file.size, out, flipVertically);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// One byte per pixel holding the palette (or gray level) index.
+struct IndexedImage
+{
+    int width = 0, height = 0;
+    std::vector<unsigned char> pixels;
+
+    // RGB triplets from the PLTE chunk, empty for grayscale images.
+    std::vector<unsigned char> palette;
+};
+
+// All functions return nullptr on success, otherwise a description of the error.
+const char *png_decode_indexed(const unsigned char *data, size_t size, IndexedImage &out, bool flipVertically = false);
+const char *png_load_indexed(const std::string &path, IndexedImage &out, bool flipVertically = false);
+const char *png_encode_indexed(const IndexedImage &image, std::vector<unsigned char> &out);
+const char *png_save_indexed(const std::string &path, const IndexedImage &image);
@@ -0,0 +1,246 @@
+#ifdef PARALLAX_PROFILER
+
+#include "Profiler.h"
+#include "File.h"
+#include <GL/gl3w.h>
+#include <imgui.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <vector>
+
+struct ProfileEvent
+{
+    const char *name;
+    long long start, end; // Nanoseconds since the profiler started
+    bool gpu;
+};
+
+struct ProfileFrame
+{
+    long long id = -1;
+    long long start = 0, end = 0;
+    std::vector<ProfileEvent> events;
+};
+
+struct PendingQuery
+{
+    unsigned int query;
+    long long frame;
+    int event;
+};
+
+static constexpr int sHistory = 240;
+
+// Milliseconds per frame for one stage, as a ring the overlay plots.
+struct ProfileStage
+{
+    float history[sHistory]{};
+};
+
+static const auto sEpoch = std::chrono::steady_clock::now();
+static ProfileFrame sFrames[sHistory];
+static long long sFrameId = 0;
+
+static std::vector<unsigned int> sFreeQueries;
+static std::deque<PendingQuery> sPendingQueries;
+static bool sGpuActive = false;
+
+static std::map<std::string, ProfileStage> sStages;
+
+static long long profiler_now(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sEpoch).count();
+}
+
+static ProfileFrame &profiler_frame(long long id)
+{
+    return sFrames[id % sHistory];
+}
+
+static int profiler_push_event(const char *name, bool gpu)
+{
+    auto &events = profiler_frame(sFrameId).events;
+    events.push_back({ name, profiler_now(), 0, gpu });
+    return static_cast<int>(events.size()) - 1;
+}
+
+static void profiler_record_stage(const std::string &name, long long frame, float ms)
+{
+    sStages[name].history[frame % sHistory] += ms;
+}
+
+ProfileScope::ProfileScope(const char *name)
+    : event(profiler_push_event(name, false))
+{
+}
+
+ProfileScope::~ProfileScope()
+{
+    profiler_frame(sFrameId).events[event].end = profiler_now();
+}
+
+ProfileGpuScope::ProfileGpuScope(const char *name)
+    : event(profiler_push_event(name, false)), query(0)
+{
+    if (sGpuActive)
+        return;
+
+    if (sFreeQueries.empty())
+    {
+        sFreeQueries.emplace_back();
+        glGenQueries(1, &sFreeQueries.back());
+    }
+
+    query = sFreeQueries.back();
+    sFreeQueries.pop_back();
+
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    sGpuActive = true;
+}
+
+ProfileGpuScope::~ProfileGpuScope()
+{
+    auto &events = profiler_frame(sFrameId).events;
+    events[event].end = profiler_now();
+
+    if (!query)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    sGpuActive = false;
+
+    // The GPU result arrives a few frames later. It is drawn starting at the
+    // CPU submission time, which is as close as TIME_ELAPSED can place it.
+    events.push_back({ events[event].name, events[event].start, 0, true });
+    sPendingQueries.push_back({ query, sFrameId, static_cast<int>(events.size()) - 1 });
+}
+
+// Collects finished queries without stalling on the ones still in flight.
+static void profiler_poll_queries(void)
+{
+    while (!sPendingQueries.empty())
+    {
+        auto pending = sPendingQueries.front();
+
+        int available = 0;
+        glGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsed);
+
+        auto &frame = profiler_frame(pending.frame);
+        if (frame.id == pending.frame)
+        {
+            auto &event = frame.events[pending.event];
+            event.end = event.start + static_cast<long long>(elapsed);
+            profiler_record_stage(std::string(event.name) + " (GPU)", pending.frame, elapsed / 1e6f);
+        }
+
+        sFreeQueries.push_back(pending.query);
+        sPendingQueries.pop_front();
+    }
+}
+
+void profiler_begin_frame(void)
+{
+    auto &frame = profiler_frame(++sFrameId);
+    frame.id = sFrameId;
+    frame.start = profiler_now();
+    frame.end = 0;
+    frame.events.clear();
+
+    for (auto &[name, stage] : sStages)
+        stage.history[sFrameId % sHistory] = 0.0f;
+}
+
+void profiler_end_frame(void)
+{
+    auto &frame = profiler_frame(sFrameId);
+    frame.end = profiler_now();
+
+    for (const auto &event : frame.events)
+    {
+        if (!event.gpu)
+            profiler_record_stage(event.name, sFrameId, (event.end - event.start) / 1e6f);
+    }
+
+    profiler_record_stage("Frame", sFrameId, (frame.end - frame.start) / 1e6f);
+    profiler_poll_queries();
+}
+
+void profiler_window(bool *open)
+{
+    if (!*open)
+        return;
+
+    ImGui::SetNextWindowSize(ImVec2(420.0f, 0.0f), ImGuiCond_FirstUseEver);
+
+    if (ImGui::Begin("Profiler", open))
+    {
+        int offset = static_cast<int>((sFrameId + 1) % sHistory);
+
+        for (auto &[name, stage] : sStages)
+        {
+            float average = 0.0f, peak = 0.0f;
+            for (float ms : stage.history)
+            {
+                average += ms;
+                peak = std::max(peak, ms);
+            }
+            average /= sHistory;
+
+            char overlay[64];
+            snprintf(overlay, sizeof(overlay), "avg %.3f ms, max %.3f ms", average, peak);
+
+            ImGui::TextUnformatted(name.c_str());
+            ImGui::PlotHistogram(("###" + name).c_str(), stage.history, sHistory, offset, overlay, 0.0f, std::max(peak, 1.0f), ImVec2(-1.0f, 40.0f));
+        }
+    }
+
+    ImGui::End();
+}
+
+const char *profiler_export_trace(const std::string &path)
+{
+    std::string json = "{\"traceEvents\":[\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"Main thread\"}},\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+    auto append = [&](const char *name, long long start, long long end, int tid) {
+        char line[256];
+        snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                 name, tid, start / 1e3, (end - start) / 1e3);
+        json += line;
+    };
+
+    // Oldest frame first, skipping slots that were never used.
+    for (long long id = std::max(1LL, sFrameId - sHistory + 1); id <= sFrameId; ++id)
+    {
+        const auto &frame = profiler_frame(id);
+        if (frame.id != id || frame.end == 0)
+            continue;
+
+        append("Frame", frame.start, frame.end, 1);
+
+        for (const auto &event : frame.events)
+        {
+            if (event.end > event.start)
+                append(event.name, event.start, event.end, event.gpu ? 2 : 1);
+        }
+    }
+
+    json += "\n]}\n";
+
+    if (!file_write_atomic(path, json.data(), json.size()))
+        return "Could not write trace file.";
+
+    return nullptr;
+}
+
+#endif
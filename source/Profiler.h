@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+
+// Frame profiler for the editor. Scopes time a block on the CPU, GPU scopes
+// additionally wrap it in a GL_TIME_ELAPSED query. Everything here compiles
+// to nothing unless PARALLAX_PROFILER is defined (CMake option of the same
+// name). Scopes are meant for the main thread only.
+
+#ifdef PARALLAX_PROFILER
+
+struct ProfileScope
+{
+    int event;
+
+    explicit ProfileScope(const char *name);
+    ~ProfileScope();
+};
+
+// GL_TIME_ELAPSED queries cannot nest; an inner GPU scope only times the CPU.
+struct ProfileGpuScope
+{
+    int event;
+    unsigned int query;
+
+    explicit ProfileGpuScope(const char *name);
+    ~ProfileGpuScope();
+};
+
+#define PROFILE_CONCAT_(_A, _B) _A##_B
+#define PROFILE_CONCAT(_A, _B) PROFILE_CONCAT_(_A, _B)
+#define PROFILE_SCOPE(_NAME) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(_NAME)
+#define PROFILE_GPU_SCOPE(_NAME) ProfileGpuScope PROFILE_CONCAT(profileGpuScope, __LINE__)(_NAME)
+
+void profiler_begin_frame(void);
+void profiler_end_frame(void);
+void profiler_window(bool *open);
+
+// Writes the frames still in the history as Chrome trace event JSON.
+// Returns nullptr on success, otherwise a description of the error.
+const char *profiler_export_trace(const std::string &path);
+
+#else
+
+#define PROFILE_SCOPE(_NAME) ((void)0)
+#define PROFILE_GPU_SCOPE(_NAME) ((void)0)
+
+inline void profiler_begin_frame(void) {}
+inline void profiler_end_frame(void) {}
+inline void profiler_window(bool *) {}
+
+#endif
@@ -0,0 +1,234 @@
+#include "Raster.h"
+#include "Png.h"
+#include "Tilemap.h"
+#include "Tileset.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RASTER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define RASTER_TARGET(_ISA)
+#else
+#define RASTER_TARGET(_ISA) __attribute__((target(_ISA)))
+#endif
+#endif
+
+void raster_render_map(const Tilemap &tilemap, const Tileset &tileset, IndexedImage &out)
+{
+    out.width = tilemap.width * 8;
+    out.height = tilemap.height * 8;
+    out.pixels.resize(static_cast<size_t>(out.width) * out.height);
+
+    for (int y = 0; y < tilemap.height; ++y)
+    for (int x = 0; x < tilemap.width; ++x)
+    {
+        unsigned short entry = tilemap_get(tilemap, x, y);
+
+        const unsigned char *tile = tileset.tiles[entry & Mask::Index];
+        unsigned char palette = static_cast<unsigned char>((entry >> 12) << 4);
+        int flipX = entry & Mask::FlipX ? 7 : 0;
+        int flipY = entry & Mask::FlipY ? 7 : 0;
+
+        unsigned char *dst = out.pixels.data() + static_cast<size_t>(y) * 8 * out.width + x * 8;
+
+        for (int py = 0; py < 8; ++py, dst += out.width)
+        {
+            for (int px = 0; px < 8; ++px)
+                dst[px] = static_cast<unsigned char>(palette | tileset_pixel(tile, px ^ flipX, py ^ flipY));
+        }
+    }
+}
+
+std::vector<unsigned char> raster_palette_table(const Palette palettes[16])
+{
+    std::vector<unsigned char> table;
+    table.reserve(16 * 16 * 3);
+
+    for (int p = 0; p < 16; ++p)
+    {
+        for (const auto &color : palettes[p])
+            table.insert(table.end(), { color.r, color.g, color.b });
+    }
+
+    return table;
+}
+
+void raster_prepare_tiles(const Tileset &tileset, RasterTiles &out)
+{
+    for (int t = 0; t < Tileset::TileCount; ++t)
+    {
+        unsigned char pixels[64];
+        tileset_unpack_tile(tileset.tiles[t], pixels);
+
+        for (int flip = 0; flip < 4; ++flip)
+        {
+            int flipX = flip & 1 ? 7 : 0, flipY = flip & 2 ? 7 : 0;
+
+            for (int y = 0; y < 8; ++y)
+            for (int x = 0; x < 8; ++x)
+                out.tiles[flip][t][x + y * 8] = pixels[(x ^ flipX) + (y ^ flipY) * 8];
+        }
+    }
+}
+
+// Slots without a palette show their color index as a gray level, like the
+// map shaders do before any palette is loaded.
+void raster_reset_palettes(RasterPalettes &out)
+{
+    for (int p = 0; p < 16; ++p)
+    for (int c = 0; c < 16; ++c)
+    {
+        out.planes[p][0][c] = out.planes[p][1][c] = out.planes[p][2][c] = static_cast<unsigned char>(c * 16);
+        out.planes[p][3][c] = 255;
+    }
+}
+
+void raster_set_palette(RasterPalettes &out, int slot, const Palette palette)
+{
+    for (int c = 0; c < 16; ++c)
+    {
+        out.planes[slot][0][c] = palette[c].r;
+        out.planes[slot][1][c] = palette[c].g;
+        out.planes[slot][2][c] = palette[c].b;
+        out.planes[slot][3][c] = 255;
+    }
+}
+
+// Writes one 8x8 tile whose indices all use the same palette.
+using RasterTileKernel = void (*)(const unsigned char *indices, const unsigned char (*planes)[16], uint32_t *dst, size_t stride);
+
+static void raster_tile_scalar(const unsigned char *indices, const unsigned char (*planes)[16], uint32_t *dst, size_t stride)
+{
+    uint32_t lut[16];
+    for (int c = 0; c < 16; ++c)
+    {
+        unsigned char rgba[4] = { planes[0][c], planes[1][c], planes[2][c], planes[3][c] };
+        memcpy(&lut[c], rgba, 4);
+    }
+
+    for (int y = 0; y < 8; ++y, dst += stride)
+    for (int x = 0; x < 8; ++x)
+        dst[x] = lut[indices[x + y * 8] & 0xF];
+}
+
+#ifdef RASTER_X86
+
+// Sixteen indices (two tile rows) per step: four shuffles look up R, G, B and
+// A, two rounds of unpacks interleave them into RGBA pixels.
+RASTER_TARGET("ssse3")
+static void raster_tile_ssse3(const unsigned char *indices, const unsigned char (*planes)[16], uint32_t *dst, size_t stride)
+{
+    const __m128i r = _mm_load_si128(reinterpret_cast<const __m128i *>(planes[0]));
+    const __m128i g = _mm_load_si128(reinterpret_cast<const __m128i *>(planes[1]));
+    const __m128i b = _mm_load_si128(reinterpret_cast<const __m128i *>(planes[2]));
+    const __m128i a = _mm_load_si128(reinterpret_cast<const __m128i *>(planes[3]));
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+
+    for (int y = 0; y < 8; y += 2, dst += stride * 2)
+    {
+        __m128i idx = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(indices + y * 8)), nibble);
+
+        __m128i rg0 = _mm_unpacklo_epi8(_mm_shuffle_epi8(r, idx), _mm_shuffle_epi8(g, idx));
+        __m128i rg1 = _mm_unpackhi_epi8(_mm_shuffle_epi8(r, idx), _mm_shuffle_epi8(g, idx));
+        __m128i ba0 = _mm_unpacklo_epi8(_mm_shuffle_epi8(b, idx), _mm_shuffle_epi8(a, idx));
+        __m128i ba1 = _mm_unpackhi_epi8(_mm_shuffle_epi8(b, idx), _mm_shuffle_epi8(a, idx));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 0), _mm_unpacklo_epi16(rg0, ba0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4), _mm_unpackhi_epi16(rg0, ba0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + stride + 0), _mm_unpacklo_epi16(rg1, ba1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + stride + 4), _mm_unpackhi_epi16(rg1, ba1));
+    }
+}
+
+// Same as above with 32 indices (four rows) per step. The shuffles and
+// unpacks work per 128-bit lane, so lane 0 holds rows 0-1 and lane 1 rows
+// 2-3 until the final permutes put each row back together.
+RASTER_TARGET("avx2")
+static void raster_tile_avx2(const unsigned char *indices, const unsigned char (*planes)[16], uint32_t *dst, size_t stride)
+{
+    const __m256i r = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(planes[0])));
+    const __m256i g = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(planes[1])));
+    const __m256i b = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(planes[2])));
+    const __m256i a = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(planes[3])));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+    for (int y = 0; y < 8; y += 4, dst += stride * 4)
+    {
+        __m256i idx = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(indices + y * 8)), nibble);
+
+        __m256i rv = _mm256_shuffle_epi8(r, idx), gv = _mm256_shuffle_epi8(g, idx);
+        __m256i bv = _mm256_shuffle_epi8(b, idx), av = _mm256_shuffle_epi8(a, idx);
+
+        __m256i rg0 = _mm256_unpacklo_epi8(rv, gv), rg1 = _mm256_unpackhi_epi8(rv, gv);
+        __m256i ba0 = _mm256_unpacklo_epi8(bv, av), ba1 = _mm256_unpackhi_epi8(bv, av);
+
+        __m256i p0 = _mm256_unpacklo_epi16(rg0, ba0), p1 = _mm256_unpackhi_epi16(rg0, ba0);
+        __m256i p2 = _mm256_unpacklo_epi16(rg1, ba1), p3 = _mm256_unpackhi_epi16(rg1, ba1);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + stride), _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + stride * 2), _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + stride * 3), _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+}
+
+static bool raster_cpu_has(const char *isa)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+
+    if (strcmp(isa, "ssse3") == 0)
+        return info[2] & (1 << 9);
+
+    // AVX2 also needs the OS to save the upper register halves.
+    bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osAvx && (info[1] & (1 << 5));
+#else
+    __builtin_cpu_init();
+    return strcmp(isa, "ssse3") == 0 ? __builtin_cpu_supports("ssse3") : __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+struct RasterKernel
+{
+    RasterTileKernel tile;
+    const char *name;
+};
+
+static const RasterKernel &raster_kernel(void)
+{
+    static const RasterKernel sKernel = [] {
+#ifdef RASTER_X86
+        if (raster_cpu_has("avx2")) return RasterKernel{ raster_tile_avx2, "AVX2" };
+        if (raster_cpu_has("ssse3")) return RasterKernel{ raster_tile_ssse3, "SSSE3" };
+#endif
+        return RasterKernel{ raster_tile_scalar, "Scalar" };
+    }();
+
+    return sKernel;
+}
+
+const char *raster_kernel_name(void)
+{
+    return raster_kernel().name;
+}
+
+void raster_render_rgba(const unsigned short *entries, size_t entryStride, int columns, int rows,
+                        const RasterTiles &tiles, const RasterPalettes &palettes, uint32_t *dst, size_t stride)
+{
+    auto kernel = raster_kernel().tile;
+
+    for (int y = 0; y < rows; ++y, entries += entryStride, dst += stride * 8)
+    for (int x = 0; x < columns; ++x)
+    {
+        unsigned short entry = entries[x];
+        kernel(tiles.tiles[(entry >> 10) & 3][entry & Mask::Index], palettes.planes[entry >> 12], dst + x * 8, stride);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Tileset.h"
+#include "Utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct IndexedImage;
+struct Tilemap;
+
+// CPU counterpart of the map shaders: decodes tile index, flips and palette
+// of every entry. Output pixels are palette * 16 + color, so they index the
+// 256 color table built by raster_palette_table().
+void raster_render_map(const Tilemap &tilemap, const Tileset &tileset, IndexedImage &out);
+std::vector<unsigned char> raster_palette_table(const Palette palettes[16]);
+
+// Every tile in all four flip orientations (indexed by the entry's flip bits
+// shifted down), so the kernels never have to flip pixels themselves.
+struct RasterTiles
+{
+    alignas(32) unsigned char tiles[4][Tileset::TileCount][64];
+};
+
+// Each palette split into R, G, B and A planes of 16 bytes, the operand
+// layout of a byte shuffle lookup.
+struct RasterPalettes
+{
+    alignas(32) unsigned char planes[16][4][16];
+};
+
+void raster_prepare_tiles(const Tileset &tileset, RasterTiles &out);
+void raster_reset_palettes(RasterPalettes &out);
+void raster_set_palette(RasterPalettes &out, int slot, const Palette palette);
+
+// Expands a grid of tilemap entries into RGBA8 pixels. The stride of dst is
+// in pixels. Uses AVX2 or SSSE3 when the CPU has them.
+void raster_render_rgba(const unsigned short *entries, size_t entryStride, int columns, int rows,
+                        const RasterTiles &tiles, const RasterPalettes &palettes, uint32_t *dst, size_t stride);
+const char *raster_kernel_name(void);
@@ -0,0 +1,61 @@
+#include "Renderer.Software.h"
+#include "Renderer.h"
+#include "AssetCache.h"
+#include <GL/gl3w.h>
+
+#include <algorithm>
+
+void renderer_upload_texture(Renderer &r, unsigned int tex, int x, int y, int w, int h, unsigned int format, unsigned int type, const void *data, size_t size);
+
+// Renders the 16 palette variants as one 256x64 tile image, which has the
+// same layout as the atlas since each variant is 16 tiles wide.
+void renderer_call_tileset_software(Renderer &r)
+{
+    static constexpr int sColumns = 16 * 16, sRows = Tileset::TileCount / 16;
+    static unsigned short sEntries[sColumns * sRows];
+
+    for (int y = 0; y < sRows; ++y)
+    for (int x = 0; x < sColumns; ++x)
+        sEntries[x + y * sColumns] = static_cast<unsigned short>((x % 16 + y * 16) | ((x / 16) << 12));
+
+    r.rasterPixels.resize(sColumns * 8 * sRows * 8);
+    raster_render_rgba(sEntries, sColumns, sColumns, sRows, r.tileset->raster, r.palettes->raster, r.rasterPixels.data(), sColumns * 8);
+
+    renderer_upload_texture(r, r.pickerFinalTex, 0, 0, sColumns * 8, sRows * 8, GL_RGBA, GL_UNSIGNED_BYTE, r.rasterPixels.data(), r.rasterPixels.size() * sizeof(uint32_t));
+}
+
+// Redraws the bounding box of the dirty tiles and uploads just that region.
+// Freshly assigned targets arrive with every tile marked dirty.
+void renderer_call_map_software(Renderer &r, const MapChunkTarget &target, const unsigned short *tiles, const std::bitset<32 * 32> &dirty)
+{
+    static constexpr unsigned short sEmptyChunk[32 * 32] = {};
+
+    if (!tiles) tiles = sEmptyChunk;
+
+    int x0 = 32, y0 = 32, x1 = 0, y1 = 0;
+
+    if (!target.stale)
+    {
+        for (int i = 0; i < 32 * 32; ++i)
+        {
+            if (!dirty.test(i)) continue;
+
+            x0 = std::min(x0, i % 32); x1 = std::max(x1, i % 32 + 1);
+            y0 = std::min(y0, i / 32); y1 = std::max(y1, i / 32 + 1);
+        }
+    }
+
+    // Stale targets, e.g. after a palette change, are redrawn completely.
+    if (x0 >= x1)
+    {
+        x0 = y0 = 0;
+        x1 = y1 = 32;
+    }
+
+    int w = x1 - x0, h = y1 - y0;
+
+    r.rasterPixels.resize(w * 8 * h * 8);
+    raster_render_rgba(tiles + x0 + y0 * 32, 32, w, h, r.tileset->raster, r.palettes->raster, r.rasterPixels.data(), w * 8);
+
+    renderer_upload_texture(r, target.finalTex, x0 * 8, y0 * 8, w * 8, h * 8, GL_RGBA, GL_UNSIGNED_BYTE, r.rasterPixels.data(), r.rasterPixels.size() * sizeof(uint32_t));
+}
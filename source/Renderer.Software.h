@@ -0,0 +1,9 @@
+#pragma once
+
+#include <bitset>
+
+struct Renderer;
+struct MapChunkTarget;
+
+void renderer_call_tileset_software(Renderer &r);
+void renderer_call_map_software(Renderer &r, const MapChunkTarget &target, const unsigned short *tiles, const std::bitset<32 * 32> &dirty);
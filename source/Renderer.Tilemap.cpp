@@ -1,67 +1,119 @@
 #include "Renderer.Tilemap.h"
 #include "Renderer.h"
+#include "AssetCache.h"
+#include "Renderer.Software.h"
+#include "Renderer.Vertex.h"
 
-#define IMGUI_DEFINE_MATH_OPERATORS
-#include <imgui.h>
 #include <GL/gl3w.h>
+#include <algorithm>
+#include <bitset>
 
 unsigned int create_shader(const char *v, const char *f);
 
 #define MAX_QUAD 32 * 32
 
-struct MapVertex
-{
-    ImVec2 pos;
-    ImVec2 uv;
-    float palette;
-};
-
 static MapVertex sMapVertices[MAX_QUAD * 4];
 
+// Unpacks MapVertex (see Renderer.Vertex.h). Corners run clockwise from the
+// top left; a flip mirrors the corner's offset inside the tile on that axis.
 static constexpr auto *mapVertexShaderSource = R"(
 #version 330 core
 
-layout (location = 0) in vec2 aPos;
-layout (location = 1) in vec2 aTexCoord;
-layout (location = 2) in float aPalette;
+layout (location = 0) in uint aPacked;
 
 out vec2 TexCoord;
+flat out uint Tile;
 flat out float Palette;
 
+const uvec2 corners[4] = uvec2[4](uvec2(0u, 0u), uvec2(1u, 0u), uvec2(1u, 1u), uvec2(0u, 1u));
+
 void main()
 {
-    gl_Position = vec4(aPos * 2.0f - 1.0f, 0.0, 1.0);
-    TexCoord = aTexCoord;
-    Palette = aPalette;
+    uint entry = aPacked & 0xFFFFu;
+    uint cell = aPacked >> 18u;
+    uvec2 corner = corners[(aPacked >> 16u) & 3u];
+
+    vec2 pos = vec2(uvec2(cell % 32u, cell / 32u) + corner) / 32.0f;
+    gl_Position = vec4(pos * 2.0f - 1.0f, 0.0, 1.0);
+
+    uvec2 uv = corner ^ uvec2((entry >> 10u) & 1u, (entry >> 11u) & 1u);
+    TexCoord = vec2(uv) * 8.0f;
+
+    Tile = entry & 0x3FFu;
+    Palette = float(entry >> 12u);
 }
 )";
 
+// TexCoord is the pixel inside the tile. texture1 holds one packed tile row
+// per texel, see renderer_create_tileset_texture().
 static constexpr auto *mapFragmentShaderSource = R"(
 #version 330 core
 
-uniform sampler2D texture1;
+uniform usampler2D texture1;
 uniform sampler2D texture2;
 
 in vec2 TexCoord;
+flat in uint Tile;
 flat in float Palette;
 out vec4 FragColor;
 
 void main()
 {
-    float x = texture(texture1, TexCoord).r;
-    vec4 color = texture(texture2, vec2(x + (16.0f / 256.0f) * Palette, 0.5f));
-	FragColor = mix(vec4(x * 16.0f), color, color.a);
+    ivec2 p = min(ivec2(TexCoord), ivec2(7));
+    uint row = texelFetch(texture1, ivec2(int(Tile % 16u) * 8 + p.y, int(Tile / 16u)), 0).r;
+    float x = float((row >> uint(p.x * 4)) & 0xFu);
+
+    vec4 color = texture(texture2, vec2((16.0f * Palette + x + 0.5f) / 256.0f, 0.5f));
+	FragColor = mix(vec4(x / 16.0f), color, color.a);
 }
 )";
 
+static constexpr auto *mapDecodeVertexShaderSource = R"(
+#version 330 core
+
+layout (location = 0) in vec2 aPos;
+
+void main()
+{
+    gl_Position = vec4(aPos, 0.0, 1.0);
+}
+)";
+
+// Decodes the raw tilemap entry covering each fragment, so the CPU only
+// uploads 16-bit entries instead of expanded vertices.
+static constexpr auto *mapDecodeFragmentShaderSource = R"(
+#version 330 core
+
+uniform usampler2D texture1;
+uniform sampler2D texture2;
+uniform usampler2D texture3;
+
+out vec4 FragColor;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    uint entry = texelFetch(texture3, pixel / 8, 0).r;
+
+    int tile = int(entry & 0x3FFu);
+    ivec2 p = pixel % 8;
+
+    if ((entry & 0x400u) != 0u) p.x = 7 - p.x;
+    if ((entry & 0x800u) != 0u) p.y = 7 - p.y;
+
+    float Palette = float(entry >> 12u);
+    uint row = texelFetch(texture1, ivec2((tile % 16) * 8 + p.y, tile / 16), 0).r;
+    float x = float((row >> uint(p.x * 4)) & 0xFu);
+
+    vec4 color = texture(texture2, vec2((16.0f * Palette + x + 0.5f) / 256.0f, 0.5f));
+	FragColor = mix(vec4(x / 16.0f), color, color.a);
+}
+)";
 
 void renderer_map_init(Renderer &r)
 {
-    glGenBuffers(1, &r.mapVertexBuffer);
     glGenBuffers(1, &r.mapElementBuffer);
 
-    glBindBuffer(GL_ARRAY_BUFFER, r.mapVertexBuffer);
-
     unsigned int quadIndices[MAX_QUAD * 6];
     {
         uint32_t offset = 0;
@@ -82,140 +134,254 @@ void renderer_map_init(Renderer &r)
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r.mapElementBuffer);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * MAX_QUAD * 6, quadIndices, GL_STATIC_DRAW);
 
-    // Generate 256-color Palette
-    glGenTextures(1, &r.mapPaletteTex);
-    glBindTexture(GL_TEXTURE_2D, r.mapPaletteTex);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-
     r.mapShader = create_shader(mapVertexShaderSource, mapFragmentShaderSource);
 
     glUseProgram(r.mapShader);
     glUniform1i(glGetUniformLocation(r.mapShader, "texture1"), 0);
     glUniform1i(glGetUniformLocation(r.mapShader, "texture2"), 1);
 
-    glGenFramebuffers(1, &r.mapFrameBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, r.mapFrameBuffer);
+    r.mapDecodeShader = create_shader(mapDecodeVertexShaderSource, mapDecodeFragmentShaderSource);
 
-    glGenTextures(1, &r.mapFinalTex);
-    glBindTexture(GL_TEXTURE_2D, r.mapFinalTex);
+    glUseProgram(r.mapDecodeShader);
+    glUniform1i(glGetUniformLocation(r.mapDecodeShader, "texture1"), 0);
+    glUniform1i(glGetUniformLocation(r.mapDecodeShader, "texture2"), 1);
+    glUniform1i(glGetUniformLocation(r.mapDecodeShader, "texture3"), 2);
+}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, 256, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+static MapChunkTarget &renderer_create_map_target(MapView &view)
+{
+    MapChunkTarget target;
+
+    glGenBuffers(1, &target.vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, target.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(sMapVertices), nullptr, GL_DYNAMIC_DRAW);
+
+    // Raw tilemap entries for the decode pipeline
+    glGenTextures(1, &target.indexTex);
+    glBindTexture(GL_TEXTURE_2D, target.indexTex);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, r.mapFinalTex, 0);
-}
-
-static constexpr auto sTileWidth = 8.0f / 256.0f;
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, 32, 32, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, nullptr);
 
-static const ImVec2 sTransformVectors[4] =
-{
-    ImVec2(0.0f, 0.0f) * sTileWidth,
-    ImVec2(1.0f, 0.0f) * sTileWidth,
-    ImVec2(1.0f, 1.0f) * sTileWidth,
-    ImVec2(0.0f, 1.0f) * sTileWidth,
-};
-
-template<class T>
-static inline void swap_val(T *v1, T *v2)
-{
-    T temp = *v1;
-    *v1 = *v2;
-    *v2 = temp;
-}
+    glGenFramebuffers(1, &target.frameBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.frameBuffer);
 
-static void renderer_draw_map_tile(Renderer &r, int i, unsigned short entry)
-{
-    unsigned int x = i % 32;
-    unsigned int y = i / 32;
+    glGenTextures(1, &target.finalTex);
+    glBindTexture(GL_TEXTURE_2D, target.finalTex);
 
-    unsigned int t = entry & Mask::Index;
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, 256, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
-    ImVec2 texCoords[4];
-    {
-        float tileW = 8.0f / 128.0f;
-        float tileH = 8.0f / 512.0f;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-        auto tileDim = ImVec2(tileW, tileH);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.finalTex, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        unsigned int x = t % 16;
-        unsigned int y = t / 16;
+    view.targets.push_back(target);
+    return view.targets.back();
+}
 
-        texCoords[0] = ImVec2(x, y); // Top-left
-        texCoords[1] = ImVec2(x + 1, y); // Top-right
-        texCoords[2] = ImVec2(x + 1, y + 1); // Bottom-right
-        texCoords[3] = ImVec2(x, y + 1); // Bottom-left
+static constexpr auto sNoDirtyTiles = std::bitset<MAX_QUAD>();
 
-        if ((entry & Mask::FlipX) == Mask::FlipX)
-        {
-            swap_val(&texCoords[0].x, &texCoords[1].x);
-            swap_val(&texCoords[2].x, &texCoords[3].x);
-        }
+// Uploads each contiguous run of dirty tiles with a single glBufferSubData.
+static void renderer_upload_dirty_tiles(const MapChunkTarget &target, const std::bitset<MAX_QUAD> &dirty)
+{
+    static constexpr auto sTileBytes = sizeof(MapVertex) * 4;
 
-        if ((entry & Mask::FlipY) == Mask::FlipY)
-        {
-            swap_val(&texCoords[1].y, &texCoords[2].y);
-            swap_val(&texCoords[0].y, &texCoords[3].y);
-        }
+    glBindBuffer(GL_ARRAY_BUFFER, target.vertexBuffer);
 
-        texCoords[0] *= tileDim;
-        texCoords[1] *= tileDim;
-        texCoords[2] *= tileDim;
-        texCoords[3] *= tileDim;
+    for (int i = 0; i < MAX_QUAD; ++i)
+    {
+        if (!dirty.test(i))
+            continue;
 
-        // invert y axis
-        texCoords[0].y = 1.0 - texCoords[0].y;
-        texCoords[1].y = 1.0 - texCoords[1].y;
-        texCoords[2].y = 1.0 - texCoords[2].y;
-        texCoords[3].y = 1.0 - texCoords[3].y;
-    }
+        int start = i;
+        while (i < MAX_QUAD && dirty.test(i)) ++i;
 
-    for (unsigned j = 0; j < 4; ++j)
-    {
-        sMapVertices[j + i * 4].pos = ImVec2(x, y) * sTileWidth + sTransformVectors[j];
-        sMapVertices[j + i * 4].uv = texCoords[j];
-        sMapVertices[j + i * 4].palette = (entry >> 12) & 0xF;
+        glBufferSubData(GL_ARRAY_BUFFER, start * sTileBytes, (i - start) * sTileBytes, &sMapVertices[start * 4]);
     }
 }
 
-void renderer_call_map(Renderer &r, unsigned short tilemap[])
+static void renderer_call_map_vertex(Renderer &r, const MapChunkTarget &target, const unsigned short *tiles, const std::bitset<MAX_QUAD> &dirty)
 {
     for (int i = 0; i < MAX_QUAD; ++i)
-        renderer_draw_map_tile(r, i, tilemap[i]);
+    {
+        if (dirty.test(i))
+            map_vertex_build_tile(&sMapVertices[i * 4], i, tiles ? tiles[i] : 0);
+    }
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, r.pickerTilesetTex);
+    glBindTexture(GL_TEXTURE_2D, r.tileset->texture);
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, r.mapPaletteTex);
+    glBindTexture(GL_TEXTURE_2D, r.palettes->texture);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r.mapElementBuffer);
 
-    glBindBuffer(GL_ARRAY_BUFFER, r.mapVertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(sMapVertices), sMapVertices, GL_STREAM_DRAW);
+    renderer_upload_dirty_tiles(target, dirty);
 
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(MapVertex), (void *)offsetof(MapVertex, pos));
+    glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(MapVertex), (void *)0);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(MapVertex), (void *)offsetof(MapVertex, uv));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(MapVertex), (void *)offsetof(MapVertex, palette));
-    glEnableVertexAttribArray(2);
+    glDisableVertexAttribArray(1);
+    glDisableVertexAttribArray(2);
 
     glUseProgram(r.mapShader);
 
     glUniform1i(glGetUniformLocation(r.mapShader, "texture1"), 0);
     glUniform1i(glGetUniformLocation(r.mapShader, "texture2"), 1);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, r.mapFrameBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.frameBuffer);
     glViewport(0, 0, 256, 256);
     glClearColor(0.0, 0.0, 0.0, 1.0);
     glClear(GL_COLOR_BUFFER_BIT);
     glDrawElements(GL_TRIANGLES, MAX_QUAD * 6, GL_UNSIGNED_INT, 0);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
+
+static void renderer_call_map_texture(Renderer &r, const MapChunkTarget &target, const unsigned short *tiles, const std::bitset<MAX_QUAD> &dirty)
+{
+    static constexpr unsigned short sEmptyChunk[MAX_QUAD] = {};
+
+    if (!tiles) tiles = sEmptyChunk;
+
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, target.indexTex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+
+    if (dirty.all())
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 32, 32, GL_RED_INTEGER, GL_UNSIGNED_SHORT, tiles);
+    }
+    else
+    {
+        // Upload each dirty run within a row, i.e. two bytes per changed tile.
+        for (int y = 0; y < 32; ++y)
+        for (int x = 0; x < 32; ++x)
+        {
+            if (!dirty.test(x + y * 32))
+                continue;
+
+            int start = x;
+            while (x < 32 && dirty.test(x + y * 32)) ++x;
+
+            glTexSubImage2D(GL_TEXTURE_2D, 0, start, y, x - start, 1, GL_RED_INTEGER, GL_UNSIGNED_SHORT, &tiles[start + y * 32]);
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, r.tileset->texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, r.palettes->texture);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r.pickerElementBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, r.pickerVertexBuffer);
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
+    glEnableVertexAttribArray(0);
+    glDisableVertexAttribArray(1);
+    glDisableVertexAttribArray(2);
+
+    glUseProgram(r.mapDecodeShader);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target.frameBuffer);
+    glViewport(0, 0, 256, 256);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static bool renderer_map_chunk_in_view(const MapView &view, const Tilemap &tilemap, int chunk)
+{
+    int cx = chunk % tilemap.chunksX, cy = chunk / tilemap.chunksX;
+    return cx >= view.x0 && cx < view.x1 && cy >= view.y0 && cy < view.y1;
+}
+
+// Finds the target showing this chunk, otherwise recycles one that scrolled
+// out of view or grows the pool.
+static MapChunkTarget &renderer_acquire_map_target(MapView &view, const Tilemap &tilemap, int chunk, bool &fresh)
+{
+    MapChunkTarget *spare = nullptr;
+
+    for (auto &target : view.targets)
+    {
+        if (target.chunk == chunk)
+        {
+            fresh = false;
+            return target;
+        }
+
+        if (!spare && (target.chunk < 0 || !renderer_map_chunk_in_view(view, tilemap, target.chunk)))
+            spare = &target;
+    }
+
+    if (!spare)
+        spare = &renderer_create_map_target(view);
+
+    fresh = true;
+    spare->chunk = chunk;
+    return *spare;
+}
+
+// Only chunks inside the view set by the map pane are rendered, and of those
+// only the ones that changed since their last render. A view rendered with
+// other assets is redrawn completely, one rendered by another backend or
+// pipeline also drops its targets, as their buffers are out of date.
+void renderer_call_map(Renderer &r, MapView &view, Tilemap &tilemap)
+{
+    if (view.generation != r.generation)
+    {
+        renderer_invalidate_map(view);
+        view.generation = r.generation;
+    }
+
+    bool stale = view.tilesetKey != r.tileset->key || view.paletteKey != r.palettes->key;
+
+    if (!stale && !view.changed && !tilemap.dirty)
+        return;
+
+    if (stale)
+    {
+        for (auto &target : view.targets)
+            target.stale = true;
+
+        view.tilesetKey = r.tileset->key;
+        view.paletteKey = r.palettes->key;
+    }
+
+    int x0 = std::max(view.x0, 0), x1 = std::min(view.x1, tilemap.chunksX);
+    int y0 = std::max(view.y0, 0), y1 = std::min(view.y1, tilemap.chunksY);
+
+    for (int cy = y0; cy < y1; ++cy)
+    for (int cx = x0; cx < x1; ++cx)
+    {
+        int chunkIdx = cx + cy * tilemap.chunksX;
+        auto *chunk = tilemap_get_chunk(tilemap, chunkIdx);
+
+        bool fresh;
+        auto &target = renderer_acquire_map_target(view, tilemap, chunkIdx, fresh);
+
+        const auto &dirty = fresh ? ~sNoDirtyTiles : chunk ? chunk->dirtyTiles : sNoDirtyTiles;
+
+        if (!target.stale && dirty.none())
+            continue;
+
+        const unsigned short *tiles = chunk ? chunk->tiles : nullptr;
+
+        if (r.backend == RendererBackend::Software)
+            renderer_call_map_software(r, target, tiles, dirty);
+        else if (r.mapPipeline == MapPipeline::Texture)
+            renderer_call_map_texture(r, target, tiles, dirty);
+        else
+            renderer_call_map_vertex(r, target, tiles, dirty);
+
+        target.stale = false;
+        if (chunk) chunk->dirtyTiles.reset();
+    }
+
+    view.changed = false;
+    tilemap.dirty = false;
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 struct Renderer;
+struct MapView;
+struct Tilemap;
 
 void renderer_map_init(Renderer &r);
-void renderer_call_map(Renderer &r, unsigned short tilemap[]);
\ No newline at end of file
+void renderer_call_map(Renderer &r, MapView &view, Tilemap &tilemap);
\ No newline at end of file
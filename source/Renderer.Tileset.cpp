@@ -1,5 +1,7 @@
 #include "Renderer.Tileset.h"
 #include "Renderer.h"
+#include "AssetCache.h"
+#include "Renderer.Software.h"
 #include <imgui.h>
 #include <GL/gl3w.h>
 
@@ -38,17 +40,24 @@ static constexpr auto *tilesetFragmentShaderSource = R"(
 #version 330 core
 out vec4 FragColor;
 
-in vec2 TexCoord;
-
 // texture samplers
-uniform sampler2D texture1;
+uniform usampler2D texture1;
 uniform sampler2D texture2;
 
+// The atlas holds one copy of the 128x512 tileset per palette, side by side,
+// with tile 0 in the first row. texture1 holds one packed tile row per texel.
 void main()
 {
-    float x = texture(texture1, TexCoord).r;
-    vec4 color = texture(texture2, vec2(x / 16.0f * 256.0f, 0.5f));
-	FragColor = mix(vec4(x * 16.0f), color, color.a);
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    int variant = pixel.x / 128;
+    ivec2 p = ivec2(pixel.x % 128, pixel.y);
+
+    int tile = (p.y / 8) * 16 + p.x / 8;
+    uint row = texelFetch(texture1, ivec2((tile % 16) * 8 + p.y % 8, tile / 16), 0).r;
+    float x = float((row >> uint((p.x % 8) * 4)) & 0xFu);
+
+    vec4 color = texture(texture2, vec2((float(variant * 16) + x + 0.5f) / 256.0f, 0.5f));
+	FragColor = mix(vec4(x / 16.0f), color, color.a);
 }
 )";
 
@@ -63,28 +72,6 @@ void renderer_tileset_init(Renderer &r)
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r.pickerElementBuffer);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(tilesetIndices), tilesetIndices, GL_STATIC_DRAW);
 
-    // Generate Tileset
-    glGenTextures(1, &r.pickerTilesetTex);
-    glBindTexture(GL_TEXTURE_2D, r.pickerTilesetTex);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, 128, 512, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
-
-    // Generate 16-color Palette
-    glGenTextures(1, &r.pickerPaletteTex);
-    glBindTexture(GL_TEXTURE_2D, r.pickerPaletteTex);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 16, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-
     r.pickerShader = create_shader(tilesetVertexShaderSource, tilesetFragmentShaderSource);
 
     glUseProgram(r.pickerShader);
@@ -97,7 +84,7 @@ void renderer_tileset_init(Renderer &r)
     glGenTextures(1, &r.pickerFinalTex);
     glBindTexture(GL_TEXTURE_2D, r.pickerFinalTex);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 128, 512, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, Renderer::PickerAtlasWidth, Renderer::PickerAtlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -105,17 +92,29 @@ void renderer_tileset_init(Renderer &r)
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, r.pickerFinalTex, 0);
 }
 
+// Renders all 16 palette variants in one pass. This only happens when the
+// tileset or the palettes change; switching palettes just shows another column.
 void renderer_call_tileset(Renderer &r)
 {
+    if (!r.pickerDirty)
+        return;
+
+    if (r.backend == RendererBackend::Software)
+    {
+        renderer_call_tileset_software(r);
+        r.pickerDirty = false;
+        return;
+    }
+
     glUseProgram(r.pickerShader);
 
     glUniform1i(glGetUniformLocation(r.pickerShader, "texture1"), 0);
     glUniform1i(glGetUniformLocation(r.pickerShader, "texture2"), 1);
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, r.pickerTilesetTex);
+    glBindTexture(GL_TEXTURE_2D, r.tileset->texture);
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, r.pickerPaletteTex);
+    glBindTexture(GL_TEXTURE_2D, r.palettes->texture);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r.pickerElementBuffer);
     glBindBuffer(GL_ARRAY_BUFFER, r.pickerVertexBuffer);
@@ -126,9 +125,11 @@ void renderer_call_tileset(Renderer &r)
     glEnableVertexAttribArray(1);
 
     glBindFramebuffer(GL_FRAMEBUFFER, r.pickerFrameBuffer);
-    glViewport(0, 0, 128, 512);
+    glViewport(0, 0, Renderer::PickerAtlasWidth, Renderer::PickerAtlasHeight);
     glClearColor(0.0, 0.0, 0.0, 1.0);
     glClear(GL_COLOR_BUFFER_BIT);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    r.pickerDirty = false;
 }
\ No newline at end of file
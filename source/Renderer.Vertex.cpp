@@ -0,0 +1,23 @@
+#include "Renderer.Vertex.h"
+
+#include <array>
+
+// The cell and corner bits of every vertex in a chunk never change.
+static constexpr auto sQuadBase = [] {
+    std::array<MapVertex, 32 * 32 * 4> base{};
+
+    for (unsigned int i = 0; i < base.size(); ++i)
+        base[i] = i << 16;
+
+    return base;
+}();
+
+void map_vertex_build_tile(MapVertex *quad, int i, unsigned short entry)
+{
+    const MapVertex *base = &sQuadBase[i * 4];
+
+    quad[0] = base[0] | entry;
+    quad[1] = base[1] | entry;
+    quad[2] = base[2] | entry;
+    quad[3] = base[3] | entry;
+}
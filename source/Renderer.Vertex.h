@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+// One map vertex in 4 bytes: bits 18-27 hold the cell within the 32x32 chunk,
+// bits 16-17 the quad corner and the low 16 bits the raw tilemap entry. The
+// map vertex shader derives position, UVs, flips and palette from that.
+using MapVertex = uint32_t;
+
+// Fills the four vertices of the quad for cell i of a 32x32 chunk.
+void map_vertex_build_tile(MapVertex *quad, int i, unsigned short entry);
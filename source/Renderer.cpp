@@ -1,12 +1,17 @@
 #include "Renderer.h"
-#include "Global.h"
+#include "AssetCache.h"
+#include "Profiler.h"
 #include <GL/gl3w.h>
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include <imgui.h>
+#include <bit>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 
 #include "Renderer.Tileset.h"
 #include "Renderer.Tilemap.h"
+#include "Renderer.Software.h"
 
 unsigned int create_shader(const char *v, const char *f)
 {
@@ -54,51 +59,225 @@ bool renderer_init(Renderer &r)
 {
     glGenVertexArrays(1, &r.vertexArray);
     glBindVertexArray(r.vertexArray);
+    glGenBuffers(1, &r.uploadBuffer);
 
     renderer_tileset_init(r);
     renderer_map_init(r);
 
+    // Drivers that emulate GL on the CPU are faster with the software backend.
+    static constexpr const char *sSoftwareDrivers[] = { "llvmpipe", "softpipe", "SVGA3D", "Microsoft Basic Render", "GDI Generic" };
+
+    if (auto name = reinterpret_cast<const char *>(glGetString(GL_RENDERER)))
+    {
+        for (auto driver : sSoftwareDrivers)
+        {
+            if (strstr(name, driver))
+                r.backend = RendererBackend::Software;
+        }
+    }
+
     return true;
 }
 
-void renderer_call(Renderer &r, unsigned short tilemap[])
+bool renderer_needs_redraw(const Renderer &r, const MapView &view, const Tilemap &tilemap)
+{
+    bool viewStale = view.generation != r.generation || view.tilesetKey != r.tilesetKey || view.paletteKey != r.paletteKey;
+
+    return r.pickerDirty || viewStale || view.changed || tilemap.dirty;
+}
+
+void renderer_call(Renderer &r, MapView &view, Tilemap &tilemap)
 {
     glBindVertexArray(r.vertexArray);
-    renderer_call_tileset(r);
-    renderer_call_map(r, tilemap);
+
+    {
+        PROFILE_GPU_SCOPE("renderer_call_tileset");
+        renderer_call_tileset(r);
+    }
+
+    {
+        PROFILE_GPU_SCOPE("renderer_call_map");
+        renderer_call_map(r, view, tilemap);
+    }
 }
 
 // Start of helpers
-void renderer_load_primary(Renderer &r, unsigned char *data)
+
+// Stages pixel data through an orphaned pixel buffer, so the texture copy is
+// queued on the GPU instead of waiting for draws that still read the texture.
+void renderer_upload_texture(Renderer &r, unsigned int tex, int x, int y, int w, int h, unsigned int format, unsigned int type, const void *data, size_t size)
 {
-    glBindTexture(GL_TEXTURE_2D, r.pickerTilesetTex);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 256, 128, 256, GL_RED, GL_UNSIGNED_BYTE, data);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, r.uploadBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+
+    if (void *staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT))
+    {
+        memcpy(staging, data, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, format, type, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 }
 
-void renderer_load_secondary(Renderer &r, unsigned char *data)
+static unsigned int renderer_create_texture(int width, int height, unsigned int internalFormat, unsigned int format)
 {
-    glBindTexture(GL_TEXTURE_2D, r.pickerTilesetTex);
-    // Account for the texture flip.
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 128, 256, GL_RED, GL_UNSIGNED_BYTE, data);
+    unsigned int tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
     glBindTexture(GL_TEXTURE_2D, 0);
+    return tex;
+}
+
+// The tiles stay packed on the GPU: every R32UI texel is one tile row of
+// eight 4-bit pixels, leftmost in the low nibble, and each texture row holds
+// sixteen tiles. That is the GBA layout, so on little-endian hosts the
+// tileset uploads as is and the shaders unpack the nibbles.
+unsigned int renderer_create_tileset_texture(Renderer &r, const Tileset &tileset)
+{
+    static constexpr int sWidth = 16 * 8, sHeight = Tileset::TileCount / 16;
+    static_assert(sizeof(tileset.tiles) == sWidth * sHeight * sizeof(uint32_t));
+
+    const void *data = tileset.tiles;
+    static uint32_t sRows[sWidth * sHeight];
+
+    if constexpr (std::endian::native == std::endian::big)
+    {
+        const unsigned char *bytes = tileset.tiles[0];
+        for (int i = 0; i < sWidth * sHeight; ++i, bytes += 4)
+            sRows[i] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+
+        data = sRows;
+    }
+
+    unsigned int tex = renderer_create_texture(sWidth, sHeight, GL_R32UI, GL_RED_INTEGER);
+    renderer_upload_texture(r, tex, 0, 0, sWidth, sHeight, GL_RED_INTEGER, GL_UNSIGNED_INT, data, sizeof(tileset.tiles));
+    return tex;
+}
+
+// All 16 palettes side by side. Slots that were not loaded keep a zero alpha,
+// which the shaders turn into a gray ramp.
+unsigned int renderer_create_palette_texture(Renderer &r, const Palette palettes[16], unsigned int loadedMask)
+{
+    unsigned char pixels[256 * 4] = {};
+
+    for (int i = 0; i < 16; ++i)
+    {
+        if (!(loadedMask & (1 << i)))
+            continue;
+
+        for (int c = 0; c < 16; ++c)
+        {
+            auto *px = pixels + (i * 16 + c) * 4;
+            px[0] = palettes[i][c].r;
+            px[1] = palettes[i][c].g;
+            px[2] = palettes[i][c].b;
+            px[3] = 255;
+        }
+    }
+
+    unsigned int tex = renderer_create_texture(256, 1, GL_RGBA, GL_RGBA);
+    renderer_upload_texture(r, tex, 0, 0, 256, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels, sizeof(pixels));
+    return tex;
+}
+
+void renderer_delete_texture(unsigned int tex)
+{
+    glDeleteTextures(1, &tex);
 }
 
-void renderer_load_palette(Renderer &r, int idx, const Palette plt)
+// Switching documents only redraws the picker if their assets differ.
+void renderer_bind_assets(Renderer &r, const TilesetAsset &tileset, const PaletteAsset &palettes)
 {
-    memcpy(r.palettes[idx], plt, sizeof(r.palettes[idx]));
+    if (r.tilesetKey != tileset.key || r.paletteKey != palettes.key)
+    {
+        r.tilesetKey = tileset.key;
+        r.paletteKey = palettes.key;
+        r.pickerDirty = true;
+    }
+
+    r.tileset = &tileset;
+    r.palettes = &palettes;
 }
 
+// The picker atlas already holds every palette variant, so switching is free.
 void renderer_change_palette(Renderer &r, int idx)
 {
-    glBindTexture(GL_TEXTURE_2D, r.pickerPaletteTex);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 16, 1, GL_RGB, GL_UNSIGNED_BYTE, r.palettes[idx]);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    r.pickerPalette = idx;
 }
 
-void renderer_load_map_palette(Renderer &r)
+// Drops every chunk render, e.g. after the tilemap was replaced or resized.
+void renderer_invalidate_map(MapView &view)
 {
-    glBindTexture(GL_TEXTURE_2D, r.mapPaletteTex);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 1, GL_RGB, GL_UNSIGNED_BYTE, r.palettes);
-    glBindTexture(GL_TEXTURE_2D, 0);
-}
\ No newline at end of file
+    for (auto &target : view.targets)
+        target.chunk = -1;
+
+    view.changed = true;
+}
+
+void renderer_release_map(MapView &view)
+{
+    for (auto &target : view.targets)
+    {
+        glDeleteBuffers(1, &target.vertexBuffer);
+        glDeleteTextures(1, &target.indexTex);
+        glDeleteFramebuffers(1, &target.frameBuffer);
+        glDeleteTextures(1, &target.finalTex);
+    }
+
+    view.targets.clear();
+    view.changed = true;
+}
+
+void renderer_set_backend(Renderer &r, RendererBackend backend)
+{
+    if (r.backend == backend)
+        return;
+
+    r.backend = backend;
+    r.pickerDirty = true;
+    ++r.generation;
+}
+
+void renderer_set_map_pipeline(Renderer &r, MapPipeline pipeline)
+{
+    if (r.mapPipeline == pipeline)
+        return;
+
+    // The inactive pipeline's buffers are stale, so rebuild everything.
+    r.mapPipeline = pipeline;
+    ++r.generation;
+}
+
+void renderer_set_map_view(MapView &view, int chunkX0, int chunkY0, int chunkX1, int chunkY1)
+{
+    if (view.x0 == chunkX0 && view.y0 == chunkY0 && view.x1 == chunkX1 && view.y1 == chunkY1)
+        return;
+
+    view.x0 = chunkX0;
+    view.y0 = chunkY0;
+    view.x1 = chunkX1;
+    view.y1 = chunkY1;
+    view.changed = true;
+}
+
+unsigned int renderer_get_map_chunk_texture(const MapView &view, int chunk)
+{
+    for (const auto &target : view.targets)
+    {
+        if (target.chunk == chunk)
+            return target.finalTex;
+    }
+
+    return 0;
+}
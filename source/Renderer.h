@@ -2,32 +2,100 @@
 
 #include <string>
 #include <array>
+#include <vector>
+#include <cstdint>
 #include "Utils.h"
+#include "Tilemap.h"
+#include "Tileset.h"
+#include "Raster.h"
+
+// Software rasterizes both panes with the SIMD kernels in Raster and only
+// uploads the finished images, for machines without a usable GPU driver.
+enum class RendererBackend : char
+{
+    OpenGL,
+    Software
+};
+
+enum class MapPipeline : char
+{
+    Vertex,
+    Texture
+};
+
+// Offscreen render of one tilemap chunk. Targets are pooled and reassigned
+// to whichever chunks are in view.
+struct MapChunkTarget
+{
+    int chunk = -1;
+    bool stale = true;
+
+    unsigned int vertexBuffer;
+    unsigned int indexTex;
+    unsigned int frameBuffer;
+    unsigned int finalTex;
+};
+
+// Chunk renders of one tilemap. Every document owns one, so switching tabs
+// keeps the renders of the other documents.
+struct MapView
+{
+    std::vector<MapChunkTarget> targets;
+    int x0 = 0, y0 = 0, x1 = 1, y1 = 1;
+    bool changed = true;
+
+    // What the targets were rendered with, see renderer_call_map().
+    uint64_t tilesetKey = 0, paletteKey = 0;
+    unsigned int generation = 0;
+};
+
+struct TilesetAsset;
+struct PaletteAsset;
 
 struct Renderer final
 {
-    bool loadedPalettes = false;
-    Palette palettes[16];
+    // The picker atlas holds one copy of the tileset per palette, side by side.
+    static constexpr int PickerAtlasWidth = Tileset::SheetWidth * 16, PickerAtlasHeight = Tileset::SheetHeight * 2;
 
     unsigned int vertexArray;
+    unsigned int uploadBuffer;
 
     unsigned int pickerVertexBuffer, pickerElementBuffer;
-    unsigned int pickerTilesetTex, pickerPaletteTex;
     unsigned int pickerFrameBuffer;
     unsigned int pickerFinalTex;
     unsigned int pickerShader;
+    int pickerPalette = 0;
+    bool pickerDirty = true; // Atlas needs a redraw.
 
-    unsigned int mapVertexBuffer, mapElementBuffer;
-    unsigned int mapFrameBuffer;
-    unsigned int mapPaletteTex;
-    unsigned int mapFinalTex;
+    unsigned int mapElementBuffer;
     unsigned int mapShader;
+
+    MapPipeline mapPipeline = MapPipeline::Texture;
+    unsigned int mapDecodeShader;
+
+    RendererBackend backend = RendererBackend::OpenGL;
+    std::vector<uint32_t> rasterPixels;
+
+    // Assets of the active document, set by renderer_bind_assets(). The keys
+    // outlive the pointers, which are only valid during the frame. Bumping the
+    // generation drops every map view's targets.
+    const TilesetAsset *tileset = nullptr;
+    const PaletteAsset *palettes = nullptr;
+    uint64_t tilesetKey = 0, paletteKey = 0;
+    unsigned int generation = 1;
 };
 
 bool renderer_init(Renderer &);
-void renderer_load_primary(Renderer &, unsigned char *data);
-void renderer_load_secondary(Renderer &, unsigned char *data);
-void renderer_load_palette(Renderer &r, int idx, const Palette plt);
+unsigned int renderer_create_tileset_texture(Renderer &r, const Tileset &tileset);
+unsigned int renderer_create_palette_texture(Renderer &r, const Palette palettes[16], unsigned int loadedMask);
+void renderer_delete_texture(unsigned int tex);
+void renderer_bind_assets(Renderer &r, const TilesetAsset &tileset, const PaletteAsset &palettes);
 void renderer_change_palette(Renderer &, int idx);
-void renderer_load_map_palette(Renderer &r);
-void renderer_call(Renderer &, unsigned short tilemap[]);
+void renderer_invalidate_map(MapView &view);
+void renderer_release_map(MapView &view);
+void renderer_set_backend(Renderer &r, RendererBackend backend);
+void renderer_set_map_pipeline(Renderer &r, MapPipeline pipeline);
+void renderer_set_map_view(MapView &view, int chunkX0, int chunkY0, int chunkX1, int chunkY1);
+unsigned int renderer_get_map_chunk_texture(const MapView &view, int chunk);
+bool renderer_needs_redraw(const Renderer &r, const MapView &view, const Tilemap &tilemap);
+void renderer_call(Renderer &, MapView &view, Tilemap &tilemap);
@@ -0,0 +1,99 @@
+#include "Scheduler.h"
+#include "Global.h"
+
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+// ImGui needs a few frames after an event for hover and active states to settle.
+static constexpr int sSettleFrames = 3;
+
+static GLFWwindow *sWindow;
+static int sPendingFrames = sSettleFrames;
+static double sWakeAt = std::numeric_limits<double>::infinity();
+static double sLastFrame = 0.0;
+static std::atomic<bool> sWoken = false;
+
+static void on_cursor_pos(GLFWwindow *, double, double) { scheduler_invalidate(); }
+static void on_mouse_button(GLFWwindow *, int, int, int) { scheduler_invalidate(); }
+static void on_scroll(GLFWwindow *, double, double) { scheduler_invalidate(); }
+static void on_char(GLFWwindow *, unsigned int) { scheduler_invalidate(); }
+static void on_size(GLFWwindow *, int, int) { scheduler_invalidate(); }
+static void on_focus(GLFWwindow *, int) { scheduler_invalidate(); }
+static void on_refresh(GLFWwindow *) { scheduler_invalidate(); }
+
+// Must run before ImGui_ImplGlfw_InitForOpenGL so that ImGui chains these callbacks.
+void scheduler_init(GLFWwindow *window)
+{
+    sWindow = window;
+
+    glfwSwapInterval(0);
+    glfwSetCursorPosCallback(window, on_cursor_pos);
+    glfwSetMouseButtonCallback(window, on_mouse_button);
+    glfwSetScrollCallback(window, on_scroll);
+    glfwSetCharCallback(window, on_char);
+    glfwSetFramebufferSizeCallback(window, on_size);
+    glfwSetWindowFocusCallback(window, on_focus);
+    glfwSetCursorEnterCallback(window, on_focus);
+    glfwSetWindowRefreshCallback(window, on_refresh);
+}
+
+void scheduler_invalidate(void)
+{
+    sPendingFrames = sSettleFrames;
+}
+
+// Builds one frame once seconds have passed, even if nothing else happens.
+void scheduler_wake_after(double seconds)
+{
+    sWakeAt = std::min(sWakeAt, glfwGetTime() + seconds);
+}
+
+// Safe to call from any thread, e.g. when a background load finishes.
+void scheduler_wake(void)
+{
+    sWoken = true;
+    glfwPostEmptyEvent();
+}
+
+// Blocks until a frame has to be built. Returns false once the window should close.
+bool scheduler_wait_for_frame(void)
+{
+    for (;;)
+    {
+        if (glfwWindowShouldClose(sWindow))
+            return false;
+
+        if (sWoken.exchange(false))
+            scheduler_invalidate();
+
+        double now = glfwGetTime();
+        double nextFrame = global.frameCap > 0 ? sLastFrame + 1.0 / global.frameCap : now;
+
+        bool wantsFrame = sPendingFrames > 0 || now >= sWakeAt || renderer_needs_redraw(global.renderer, global.document->view, global.document->tilemap);
+
+        if (!wantsFrame && sWakeAt < std::numeric_limits<double>::infinity())
+            glfwWaitEventsTimeout(sWakeAt - now);
+        else if (!wantsFrame)
+            glfwWaitEvents();
+        else if (now < nextFrame)
+            glfwWaitEventsTimeout(nextFrame - now);
+        else
+            break;
+    }
+
+    glfwPollEvents();
+    return true;
+}
+
+void scheduler_end_frame(void)
+{
+    sLastFrame = glfwGetTime();
+
+    if (sLastFrame >= sWakeAt)
+        sWakeAt = std::numeric_limits<double>::infinity();
+
+    if (sPendingFrames > 0)
+        --sPendingFrames;
+}
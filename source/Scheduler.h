@@ -0,0 +1,10 @@
+#pragma once
+
+struct GLFWwindow;
+
+void scheduler_init(GLFWwindow *window);
+void scheduler_invalidate(void);
+void scheduler_wake_after(double seconds);
+void scheduler_wake(void);
+bool scheduler_wait_for_frame(void);
+void scheduler_end_frame(void);
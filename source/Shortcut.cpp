@@ -8,6 +8,8 @@ static constexpr unsigned int sShortcutMask = GLFW_MOD_SHIFT | GLFW_MOD_CONTROL
 
 static const Shortcut sShortcuts[] =
 {
+    { GLFW_KEY_T, GLFW_MOD_CONTROL, new_document },
+    { GLFW_KEY_W, GLFW_MOD_CONTROL, close_document },
     { GLFW_KEY_O, GLFW_MOD_CONTROL, open_tilemap },
     { GLFW_KEY_O, GLFW_MOD_CONTROL | GLFW_MOD_SHIFT, open_palettes },
     { GLFW_KEY_1, GLFW_MOD_CONTROL | GLFW_MOD_SHIFT, open_primary_tileset },
@@ -16,6 +18,7 @@ static const Shortcut sShortcuts[] =
     { GLFW_KEY_Y, GLFW_MOD_CONTROL, action_stack_do_redo, true },
     { GLFW_KEY_S, GLFW_MOD_CONTROL, save_tilemap },
     { GLFW_KEY_S, GLFW_MOD_CONTROL | GLFW_MOD_SHIFT, save_as_tilemap },
+    { GLFW_KEY_F, GLFW_MOD_CONTROL, show_find_tile },
 };
 
 void shortcut_callback(int key, int mods, int action)
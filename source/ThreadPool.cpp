@@ -0,0 +1,121 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ThreadPool
+{
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> jobs;
+    std::vector<std::thread> workers;
+    bool quit = false;
+
+    ThreadPool()
+    {
+        size_t count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+        for (size_t i = 0; i < count; ++i)
+            workers.emplace_back([this] { run(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard lock(mutex);
+            quit = true;
+        }
+
+        wake.notify_all();
+        for (auto &worker : workers) worker.join();
+    }
+
+    void run(void)
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+
+            {
+                std::unique_lock lock(mutex);
+                wake.wait(lock, [this] { return quit || !jobs.empty(); });
+
+                if (jobs.empty())
+                    return;
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            job();
+        }
+    }
+};
+
+static ThreadPool &thread_pool(void)
+{
+    static ThreadPool sPool;
+    return sPool;
+}
+
+size_t thread_pool_size(void)
+{
+    return thread_pool().workers.size();
+}
+
+void thread_pool_submit(std::function<void()> job)
+{
+    auto &pool = thread_pool();
+
+    {
+        std::lock_guard lock(pool.mutex);
+        pool.jobs.push_back(std::move(job));
+    }
+
+    pool.wake.notify_one();
+}
+
+// The calling thread takes part in the loop, so this also makes progress when
+// called from inside a pool job.
+void thread_pool_parallel_for(size_t count, const std::function<void(size_t)> &func)
+{
+    if (count == 0)
+        return;
+
+    struct State
+    {
+        std::atomic<size_t> next = 0, done = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    auto state = std::make_shared<State>();
+
+    auto work = [state, count, &func] {
+        size_t completed = 0;
+
+        for (size_t i; (i = state->next++) < count; ++completed)
+            func(i);
+
+        if (completed && state->done.fetch_add(completed) + completed == count)
+        {
+            std::lock_guard lock(state->mutex);
+            state->finished.notify_all();
+        }
+    };
+
+    size_t helpers = std::min(count - 1, thread_pool_size());
+    for (size_t i = 0; i < helpers; ++i)
+        thread_pool_submit(work);
+
+    work();
+
+    std::unique_lock lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done == count; });
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+size_t thread_pool_size(void);
+void thread_pool_submit(std::function<void()> job);
+void thread_pool_parallel_for(size_t count, const std::function<void(size_t)> &func);
@@ -0,0 +1,417 @@
+#include "TileIndex.h"
+#include "File.h"
+#include "ThreadPool.h"
+#include "Tilemap.h"
+#include "Tilemap.IO.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// File layout, little endian:
+//   "PXIX", u32 version, u32 map count, then per map:
+//   u16 path length, path, u64 size, u64 mtime, u64 hash, u16 width,
+//   u16 height, u32 use count, then per use two varints: the tile delta to
+//   the previous use, and the cell delta (absolute on a new tile) shifted
+//   left by 6 with the flip and palette bits below it. Most uses take 2-3 bytes.
+static constexpr char sMagic[4] = { 'P', 'X', 'I', 'X' };
+static constexpr uint32_t sVersion = 1;
+
+struct IndexWriter
+{
+    std::vector<unsigned char> data;
+
+    void u8(unsigned int v) { data.push_back(static_cast<unsigned char>(v)); }
+    void u16(unsigned int v) { u8(v); u8(v >> 8); }
+    void u32(uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); }
+    void u64(uint64_t v) { u32(static_cast<uint32_t>(v)); u32(static_cast<uint32_t>(v >> 32)); }
+
+    void varint(uint64_t v)
+    {
+        for (; v >= 0x80; v >>= 7)
+            u8((v & 0x7F) | 0x80);
+
+        u8(static_cast<unsigned int>(v));
+    }
+};
+
+struct IndexReader
+{
+    const unsigned char *data, *end;
+    bool failed = false;
+
+    bool need(size_t n)
+    {
+        if (static_cast<size_t>(end - data) < n) failed = true;
+        return !failed;
+    }
+
+    unsigned int u8(void) { return need(1) ? *data++ : 0; }
+    unsigned int u16(void) { unsigned int lo = u8(); return lo | (u8() << 8); }
+    uint32_t u32(void) { uint32_t lo = u16(); return lo | (static_cast<uint32_t>(u16()) << 16); }
+    uint64_t u64(void) { uint64_t lo = u32(); return lo | (static_cast<uint64_t>(u32()) << 32); }
+
+    uint64_t varint(void)
+    {
+        uint64_t v = 0;
+
+        for (int shift = 0; shift < 64 && !failed; shift += 7)
+        {
+            unsigned int b = u8();
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+
+        failed = true;
+        return 0;
+    }
+};
+
+// FNV-1a
+static uint64_t tile_index_hash(const unsigned char *data, size_t size)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * 0x100000001B3ull;
+
+    return hash;
+}
+
+static void tile_index_finish_map(TileIndexMap &map)
+{
+    map.paletteMask = 0;
+
+    for (const auto &use : map.uses)
+        map.paletteMask |= 1 << (use.entry >> 12);
+}
+
+const char *tile_index_load(TileIndex &index, const std::string &path)
+{
+    MappedFile file;
+    if (!file_map(file, path))
+        return "Could not open index file.";
+
+    IndexReader in{ file.data, file.data + file.size };
+
+    if (!in.need(sizeof(sMagic)) || memcmp(in.data, sMagic, sizeof(sMagic)) != 0)
+        return "Not a tile index file.";
+
+    in.data += sizeof(sMagic);
+
+    if (in.u32() != sVersion)
+        return "Unsupported tile index version.";
+
+    uint32_t count = in.u32();
+    std::vector<TileIndexMap> maps;
+
+    for (uint32_t m = 0; m < count && !in.failed; ++m)
+    {
+        TileIndexMap map;
+
+        unsigned int length = in.u16();
+        if (!in.need(length)) break;
+
+        map.path.assign(reinterpret_cast<const char *>(in.data), length);
+        in.data += length;
+
+        map.size = in.u64();
+        map.mtime = static_cast<int64_t>(in.u64());
+        map.hash = in.u64();
+        map.width = in.u16();
+        map.height = in.u16();
+
+        uint32_t uses = in.u32();
+        uint64_t cells = static_cast<uint64_t>(map.width) * map.height;
+
+        // Every use takes at least two bytes, which bounds the allocation.
+        if (!in.need(uses * 2ull)) break;
+        map.uses.resize(uses);
+
+        uint64_t tile = 0, cell = 0;
+
+        for (auto &use : map.uses)
+        {
+            uint64_t tileDelta = in.varint();
+            uint64_t packed = in.varint();
+
+            if (tileDelta) cell = 0;
+            tile += tileDelta;
+            cell += packed >> 6;
+
+            if (tile > Mask::Index || cell >= cells)
+            {
+                in.failed = true;
+                break;
+            }
+
+            use.cell = static_cast<uint32_t>(cell);
+            use.entry = static_cast<uint16_t>(tile | (packed & 0x3F) << 10);
+        }
+
+        tile_index_finish_map(map);
+        maps.push_back(std::move(map));
+    }
+
+    if (in.failed)
+        return "Tile index file is truncated or corrupt.";
+
+    index.maps = std::move(maps);
+    return nullptr;
+}
+
+const char *tile_index_save(const TileIndex &index, const std::string &path)
+{
+    IndexWriter out;
+
+    out.data.insert(out.data.end(), sMagic, sMagic + sizeof(sMagic));
+    out.u32(sVersion);
+    out.u32(static_cast<uint32_t>(index.maps.size()));
+
+    for (const auto &map : index.maps)
+    {
+        out.u16(static_cast<unsigned int>(map.path.size()));
+        out.data.insert(out.data.end(), map.path.begin(), map.path.end());
+        out.u64(map.size);
+        out.u64(static_cast<uint64_t>(map.mtime));
+        out.u64(map.hash);
+        out.u16(map.width);
+        out.u16(map.height);
+        out.u32(static_cast<uint32_t>(map.uses.size()));
+
+        unsigned int tile = 0;
+        uint32_t cell = 0;
+
+        for (const auto &use : map.uses)
+        {
+            unsigned int useTile = use.entry & Mask::Index;
+            if (useTile != tile) cell = 0;
+
+            out.varint(useTile - tile);
+            out.varint(static_cast<uint64_t>(use.cell - cell) << 6 | use.entry >> 10);
+
+            tile = useTile;
+            cell = use.cell;
+        }
+    }
+
+    if (!file_write_atomic(path, out.data.data(), out.data.size()))
+        return "Could not write index file.";
+
+    return nullptr;
+}
+
+std::string tile_index_default_path(const std::string &root)
+{
+    return (fs::path(root) / ".parallax_index").string();
+}
+
+// Walks the map row by row and buckets the cells by tile, which leaves each
+// tile's cells in ascending order without a sort.
+static void tile_index_build_uses(const Tilemap &tilemap, TileIndexMap &map)
+{
+    static constexpr int sSize = TilemapChunk::Size;
+
+    std::vector<TileIndexUse> cells;
+
+    for (int y = 0; y < tilemap.height; ++y)
+    for (int cx = 0; cx < tilemap.chunksX; ++cx)
+    {
+        auto *chunk = tilemap_get_chunk(tilemap, cx + (y / sSize) * tilemap.chunksX);
+        if (!chunk) continue;
+
+        const unsigned short *row = chunk->tiles + (y % sSize) * sSize;
+        int x1 = std::min(sSize, tilemap.width - cx * sSize);
+
+        for (int x = 0; x < x1; ++x)
+        {
+            if (row[x])
+                cells.push_back({ static_cast<uint32_t>(cx * sSize + x + y * tilemap.width), row[x] });
+        }
+    }
+
+    uint32_t starts[Mask::Index + 2] = {};
+
+    for (const auto &use : cells)
+        ++starts[(use.entry & Mask::Index) + 1];
+
+    for (int t = 0; t <= Mask::Index; ++t)
+        starts[t + 1] += starts[t];
+
+    map.uses.resize(cells.size());
+
+    for (const auto &use : cells)
+        map.uses[starts[use.entry & Mask::Index]++] = use;
+
+    map.width = tilemap.width;
+    map.height = tilemap.height;
+    tile_index_finish_map(map);
+}
+
+enum class IndexState : char
+{
+    Kept,
+    Touched,
+    Indexed,
+    Failed
+};
+
+const char *tile_index_update(TileIndex &index, const std::string &root, TileIndexStats &stats)
+{
+    std::error_code ec;
+    std::vector<std::string> paths;
+
+    for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        if (it->is_regular_file(ec) && file_extension(it->path().string()) == ".bin")
+            paths.push_back(it->path().lexically_relative(root).generic_string());
+    }
+
+    if (ec)
+        return "Could not scan the project directory.";
+
+    std::sort(paths.begin(), paths.end());
+
+    // Both lists are sorted, so one merge pairs every path with its old entry.
+    auto &old = index.maps;
+    std::vector<TileIndexMap *> previous(paths.size());
+
+    for (size_t i = 0, j = 0; i < paths.size(); ++i)
+    {
+        while (j < old.size() && old[j].path < paths[i]) ++j;
+        if (j < old.size() && old[j].path == paths[i]) previous[i] = &old[j];
+    }
+
+    std::vector<TileIndexMap> maps(paths.size());
+    std::vector<IndexState> states(paths.size());
+
+    // Each new entry moves from at most one old entry, so this is race free.
+    thread_pool_parallel_for(paths.size(), [&](size_t i) {
+        auto &map = maps[i];
+        auto *prev = previous[i];
+        map.path = paths[i];
+
+        auto full = fs::path(root) / fs::path(paths[i]);
+        std::error_code sizeError, timeError;
+        map.size = fs::file_size(full, sizeError);
+        map.mtime = fs::last_write_time(full, timeError).time_since_epoch().count();
+
+        if (prev && !sizeError && !timeError && prev->size == map.size && prev->mtime == map.mtime)
+        {
+            map = std::move(*prev);
+            states[i] = IndexState::Kept;
+            return;
+        }
+
+        MappedFile file;
+        if (!file_map(file, full.string()))
+        {
+            states[i] = IndexState::Failed;
+            return;
+        }
+
+        map.size = file.size;
+        map.hash = tile_index_hash(file.data, file.size);
+
+        if (prev && prev->size == map.size && prev->hash == map.hash)
+        {
+            int64_t mtime = map.mtime;
+            map = std::move(*prev);
+            map.mtime = mtime;
+            states[i] = IndexState::Touched;
+            return;
+        }
+
+        Tilemap tilemap;
+        if (tilemap_read(tilemap, file.data, file.size))
+        {
+            states[i] = IndexState::Failed;
+            return;
+        }
+
+        tile_index_build_uses(tilemap, map);
+        states[i] = IndexState::Indexed;
+    });
+
+    stats = TileIndexStats();
+
+    // Maps that vanished or no longer load count as removed.
+    size_t carried = 0;
+    std::vector<TileIndexMap> result;
+    result.reserve(maps.size());
+
+    for (size_t i = 0; i < maps.size(); ++i)
+    {
+        if (states[i] == IndexState::Failed) continue;
+
+        if (previous[i]) ++carried;
+        if (states[i] == IndexState::Indexed) ++stats.indexed;
+        if (states[i] != IndexState::Kept) stats.changed = true;
+
+        result.push_back(std::move(maps[i]));
+    }
+
+    stats.maps = result.size();
+    stats.removed = old.size() - carried;
+    stats.changed |= stats.removed > 0;
+
+    index.maps = std::move(result);
+    return nullptr;
+}
+
+const char *tile_index_refresh(TileIndex &index, const std::string &root, TileIndexStats &stats)
+{
+    std::string path = tile_index_default_path(root);
+
+    if (tile_index_load(index, path))
+        index.maps.clear();
+
+    if (const char *error = tile_index_update(index, root, stats))
+        return error;
+
+    return stats.changed ? tile_index_save(index, path) : nullptr;
+}
+
+void tile_index_find(const TileIndex &index, uint16_t mask, uint16_t value, std::vector<TileIndexHit> &hits)
+{
+    value &= mask;
+
+    bool byTile = (mask & Mask::Index) == Mask::Index;
+    bool byPalette = (mask & 0xF000) == 0xF000;
+
+    for (size_t m = 0; m < index.maps.size(); ++m)
+    {
+        const auto &map = index.maps[m];
+
+        if (byPalette && !(map.paletteMask & (1 << (value >> 12))))
+            continue;
+
+        auto begin = map.uses.begin(), end = map.uses.end();
+
+        if (byTile)
+        {
+            unsigned int tile = value & Mask::Index;
+            auto byIndex = [](const TileIndexUse &use) -> unsigned int { return use.entry & Mask::Index; };
+
+            begin = std::partition_point(begin, end, [&](const TileIndexUse &use) { return byIndex(use) < tile; });
+            end = std::partition_point(begin, end, [&](const TileIndexUse &use) { return byIndex(use) == tile; });
+        }
+
+        // Maps are indexed at their guessed shape, whose width is a whole
+        // number of screenblocks.
+        static constexpr int sSize = TilemapChunk::Size;
+        int blocksX = (map.width + sSize - 1) / sSize;
+
+        for (auto it = begin; it != end; ++it)
+        {
+            if ((it->entry & mask) != value)
+                continue;
+
+            int x = static_cast<int>(it->cell % map.width), y = static_cast<int>(it->cell / map.width);
+            hits.push_back({ static_cast<uint32_t>(m), x / sSize + (y / sSize) * blocksX, x % sSize, y % sSize, it->entry });
+        }
+    }
+}
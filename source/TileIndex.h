@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One non-empty cell of an indexed map.
+struct TileIndexUse
+{
+    uint32_t cell;
+    uint16_t entry;
+};
+
+struct TileIndexMap
+{
+    std::string path; // Relative to the project root, '/' separated.
+    uint64_t size = 0, hash = 0;
+    int64_t mtime = 0;
+    int width = 0, height = 0;
+
+    // Sorted by tile index, then by cell, so a tile's uses are one range.
+    std::vector<TileIndexUse> uses;
+    uint16_t paletteMask = 0;
+};
+
+// Which cells of which tilemaps in a project reference each tile and palette.
+// Entry 0, the empty cell, is not recorded.
+struct TileIndex
+{
+    std::vector<TileIndexMap> maps; // Sorted by path.
+};
+
+struct TileIndexStats
+{
+    size_t maps = 0, indexed = 0, removed = 0;
+    bool changed = false;
+};
+
+// A .bin file does not record its shape, so a use is located by its
+// screenblock in file order and its cell within that screenblock, which
+// hold whatever shape the map is opened at.
+struct TileIndexHit
+{
+    uint32_t map;
+    int block, x, y;
+    uint16_t entry;
+};
+
+// All functions return nullptr on success, otherwise a description of the error.
+const char *tile_index_load(TileIndex &index, const std::string &path);
+const char *tile_index_save(const TileIndex &index, const std::string &path);
+std::string tile_index_default_path(const std::string &root);
+
+// Rescans every .bin below root in parallel. Maps whose size and mtime, or
+// failing that their content hash, are unchanged keep their recorded uses.
+const char *tile_index_update(TileIndex &index, const std::string &root, TileIndexStats &stats);
+
+// Loads the index stored in the project, updates it and writes it back if
+// anything changed. A missing or unreadable index file is rebuilt.
+const char *tile_index_refresh(TileIndex &index, const std::string &root, TileIndexStats &stats);
+
+// Finds every use whose entry matches value on the bits in mask, e.g.
+// Mask::Index for a tile or 0xF000 for a palette.
+void tile_index_find(const TileIndex &index, uint16_t mask, uint16_t value, std::vector<TileIndexHit> &hits);
@@ -0,0 +1,158 @@
+#include "TileOptimizer.h"
+#include "Tilemap.h"
+#include "Utils.h"
+
+#include <cstring>
+#include <unordered_map>
+
+PackedTile tile_optimizer_pack(const unsigned char *pixels)
+{
+    PackedTile tile{};
+
+    for (int y = 0; y < 8; ++y)
+    for (int x = 0; x < 8; ++x)
+        tile.rows[y / 2] |= static_cast<uint64_t>(pixels[x + y * 8] & 0xF) << ((y % 2) * 32 + x * 4);
+
+    return tile;
+}
+
+// Tileset tiles are already packed the same way, row by row in little endian.
+static PackedTile tile_optimizer_load(const unsigned char *tile)
+{
+    PackedTile packed{};
+
+    for (int i = 0; i < Tileset::TileBytes; ++i)
+        packed.rows[i / 8] |= static_cast<uint64_t>(tile[i]) << ((i % 8) * 8);
+
+    return packed;
+}
+
+// Reverses the nibbles inside each 32-bit row.
+static uint64_t flip_rows_x(uint64_t w)
+{
+    w = ((w >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((w & 0x0F0F0F0F0F0F0F0Full) << 4);
+    w = ((w >> 8) & 0x00FF00FF00FF00FFull) | ((w & 0x00FF00FF00FF00FFull) << 8);
+    w = ((w >> 16) & 0x0000FFFF0000FFFFull) | ((w & 0x0000FFFF0000FFFFull) << 16);
+    return w;
+}
+
+static PackedTile flip_x(const PackedTile &tile)
+{
+    return { flip_rows_x(tile.rows[0]), flip_rows_x(tile.rows[1]), flip_rows_x(tile.rows[2]), flip_rows_x(tile.rows[3]) };
+}
+
+static PackedTile flip_y(const PackedTile &tile)
+{
+    auto swap = [](uint64_t w) { return (w >> 32) | (w << 32); };
+    return { swap(tile.rows[3]), swap(tile.rows[2]), swap(tile.rows[1]), swap(tile.rows[0]) };
+}
+
+static bool less(const PackedTile &a, const PackedTile &b)
+{
+    return memcmp(a.rows, b.rows, sizeof(a.rows)) < 0;
+}
+
+// Picks the smallest of the four flip variants as the canonical form and
+// returns the flip bits that turn the canonical form back into the tile.
+PackedTile tile_optimizer_canonicalize(const PackedTile &tile, unsigned short &flips)
+{
+    PackedTile variants[4];
+    variants[0] = tile;
+    variants[1] = flip_x(tile);
+    variants[2] = flip_y(tile);
+    variants[3] = flip_y(variants[1]);
+
+    static constexpr unsigned short sFlips[4] = { 0, Mask::FlipX, Mask::FlipY, Mask::FlipX | Mask::FlipY };
+
+    int best = 0;
+    for (int i = 1; i < 4; ++i)
+    {
+        if (less(variants[i], variants[best]))
+            best = i;
+    }
+
+    flips = sFlips[best];
+    return variants[best];
+}
+
+int tile_optimizer_run(Tileset &tileset, TileRemap &remap)
+{
+    static constexpr unsigned short sFlipMask = Mask::FlipX | Mask::FlipY;
+
+    // Canonical form -> first tile with that form and its flips relative to it.
+    std::unordered_map<PackedTile, unsigned short, PackedTileHash> seen;
+    seen.reserve(Tileset::TileCount);
+
+    unsigned short kept[Tileset::TileCount];
+    int nextSlot[2] = { 0, Tileset::SheetTiles };
+    int removed = 0;
+
+    // Tiles are visited in index order, so a secondary tile may fold into a
+    // primary one but never the other way around.
+    for (int t = 0; t < Tileset::TileCount; ++t)
+    {
+        unsigned short flips;
+        PackedTile canonical = tile_optimizer_canonicalize(tile_optimizer_load(tileset.tiles[t]), flips);
+
+        auto [it, inserted] = seen.try_emplace(canonical, static_cast<unsigned short>(t | flips));
+
+        if (inserted)
+        {
+            int slot = nextSlot[t >= Tileset::SheetTiles]++;
+            kept[slot] = static_cast<unsigned short>(t);
+            remap.tiles[t] = static_cast<unsigned short>(slot);
+        }
+        else
+        {
+            // tile = flip(canonical, flips) and first = flip(canonical, firstFlips),
+            // so tile = flip(first, flips ^ firstFlips).
+            unsigned short first = it->second;
+            remap.tiles[t] = (remap.tiles[first & Mask::Index] & Mask::Index) | ((flips ^ first) & sFlipMask);
+            ++removed;
+        }
+    }
+
+    unsigned char compacted[Tileset::TileCount][Tileset::TileBytes] = {};
+
+    for (int sheet = 0; sheet < 2; ++sheet)
+    {
+        for (int slot = sheet * Tileset::SheetTiles; slot < nextSlot[sheet]; ++slot)
+            memcpy(compacted[slot], tileset.tiles[kept[slot]], Tileset::TileBytes);
+    }
+
+    memcpy(tileset.tiles, compacted, sizeof(compacted));
+    return removed;
+}
+
+unsigned short tile_optimizer_remap_entry(const TileRemap &remap, unsigned short entry)
+{
+    static constexpr unsigned short sFlipMask = Mask::FlipX | Mask::FlipY;
+
+    unsigned short moved = remap.tiles[entry & Mask::Index];
+    return (entry & ~(Mask::Index | sFlipMask)) | (moved & Mask::Index) | ((entry ^ moved) & sFlipMask);
+}
+
+void tile_optimizer_remap(Tilemap &tilemap, const TileRemap &remap)
+{
+    for (auto &chunk : tilemap.chunks)
+    {
+        if (!chunk)
+            continue;
+
+        for (int i = 0; i < TilemapChunk::Area; ++i)
+        {
+            unsigned short tile = tile_optimizer_remap_entry(remap, chunk->tiles[i]);
+
+            if (tile != chunk->tiles[i])
+            {
+                chunk->tiles[i] = tile;
+                chunk->dirtyTiles.set(i);
+                tilemap.dirty = true;
+            }
+        }
+    }
+
+    // Nearly every cell may have moved, so rebuilding beats patching.
+    if (tilemap.usage)
+        tile_usage_build(*tilemap.usage, tilemap);
+}
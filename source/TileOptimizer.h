@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Tileset.h"
+
+#include <cstddef>
+#include <cstdint>
+
+struct Tilemap;
+
+// An 8x8 4bpp tile packed two rows per word, one nibble per pixel with the
+// leftmost pixel in the lowest nibble. Flips become a handful of shifts and
+// masks over the four words instead of per-pixel loops.
+struct PackedTile
+{
+    uint64_t rows[4];
+
+    bool operator==(const PackedTile &) const = default;
+};
+
+struct PackedTileHash
+{
+    size_t operator()(const PackedTile &tile) const
+    {
+        uint64_t h = tile.rows[0] * 0x9E3779B97F4A7C15ull;
+        h ^= tile.rows[1] * 0xC2B2AE3D27D4EB4Full + (h >> 29);
+        h ^= tile.rows[2] * 0x165667B19E3779F9ull + (h >> 31);
+        h ^= tile.rows[3] * 0xD6E8FEB86659FD93ull + (h >> 27);
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+};
+
+// Where every tile of the original sheets ended up: the new tile index plus
+// the flip bits that turn the new tile back into the original one.
+struct TileRemap
+{
+    unsigned short tiles[Tileset::TileCount];
+};
+
+// Merges tiles that are identical up to an X and/or Y flip, then packs the
+// remaining tiles of each sheet to its front. Primary tiles only ever merge
+// with other primary tiles, so the primary sheet stays valid on its own.
+// Returns the number of tiles that were removed.
+int tile_optimizer_run(Tileset &tileset, TileRemap &remap);
+unsigned short tile_optimizer_remap_entry(const TileRemap &remap, unsigned short entry);
+void tile_optimizer_remap(Tilemap &tilemap, const TileRemap &remap);
+
+// Building blocks for producing deduplicated tiles elsewhere. The canonical
+// form is the same for all four flips of a tile; flips receives the
+// Mask::FlipX/FlipY bits that turn the canonical form back into the tile.
+PackedTile tile_optimizer_pack(const unsigned char *pixels);
+PackedTile tile_optimizer_canonicalize(const PackedTile &tile, unsigned short &flips);
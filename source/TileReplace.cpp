@@ -0,0 +1,355 @@
+#include "TileReplace.h"
+#include "File.h"
+#include "ThreadPool.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+
+// SSE2 is part of every x86-64 CPU, so only AVX2 needs a runtime check.
+#if defined(__x86_64__) || defined(_M_X64)
+#define REPLACE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define REPLACE_TARGET(_ISA)
+#else
+#define REPLACE_TARGET(_ISA) __attribute__((target(_ISA)))
+#endif
+#endif
+
+namespace fs = std::filesystem;
+
+static bool parse_field(std::string_view token, uint16_t &mask, uint16_t &value)
+{
+    struct Field { const char *name; uint16_t mask; int shift; };
+
+    static constexpr Field sFields[] = {
+        { "tile", Mask::Index, 0 },
+        { "flipx", Mask::FlipX, 10 },
+        { "flipy", Mask::FlipY, 11 },
+        { "palette", 0xF000, 12 },
+    };
+
+    size_t eq = token.find('=');
+    if (eq == std::string_view::npos || eq + 1 == token.size())
+        return false;
+
+    std::string_view name = token.substr(0, eq);
+    std::string number(token.substr(eq + 1));
+
+    char *end;
+    long v = strtol(number.c_str(), &end, 0);
+    if (*end != '\0' || v < 0)
+        return false;
+
+    for (const auto &field : sFields)
+    {
+        if (name != field.name || v > (field.mask >> field.shift))
+            continue;
+
+        mask |= field.mask;
+        value = static_cast<uint16_t>((value & ~field.mask) | (v << field.shift));
+        return true;
+    }
+
+    return false;
+}
+
+const char *tile_replace_parse(const std::string &text, std::vector<TileReplaceRule> &rules, size_t &errorLine)
+{
+    std::string_view rest(text);
+
+    for (errorLine = 1; !rest.empty(); ++errorLine)
+    {
+        size_t end = rest.find('\n');
+        std::string_view line = rest.substr(0, end);
+        rest = end == std::string_view::npos ? std::string_view() : rest.substr(end + 1);
+
+        TileReplaceRule rule;
+        bool seenArrow = false, any = false;
+
+        for (size_t pos = 0; pos < line.size();)
+        {
+            pos = line.find_first_not_of(" \t\r", pos);
+            if (pos == std::string_view::npos) break;
+
+            size_t stop = std::min(line.find_first_of(" \t\r", pos), line.size());
+            std::string_view token = line.substr(pos, stop - pos);
+            pos = stop;
+
+            if (!any && token[0] == '#')
+                break;
+
+            any = true;
+
+            if (token == "->")
+            {
+                if (seenArrow) return "Rule has more than one \"->\".";
+                seenArrow = true;
+            }
+            else if (!(seenArrow ? parse_field(token, rule.setMask, rule.set) : parse_field(token, rule.mask, rule.match)))
+            {
+                return "Expected tile=, palette=, flipx= or flipy= with a value in range.";
+            }
+        }
+
+        if (!any)
+            continue;
+
+        if (!seenArrow || !rule.setMask)
+            return "Rule needs a replacement after \"->\".";
+
+        // Such a rule reads as one for empty cells, but those are skipped.
+        if ((rule.mask & Mask::Index) && rule.match == 0)
+            return "Pattern matches the empty cell, which is never replaced; name a nonzero palette or a flip for tile 0.";
+
+        rules.push_back(rule);
+    }
+
+    errorLine = 0;
+    return nullptr;
+}
+
+const char *tile_replace_load(const std::string &path, std::vector<TileReplaceRule> &rules, size_t &errorLine)
+{
+    errorLine = 0;
+
+    MappedFile file;
+    if (!file_map(file, path))
+        return "Could not open the replacement table.";
+
+    return tile_replace_parse(std::string(reinterpret_cast<const char *>(file.data), file.size), rules, errorLine);
+}
+
+static size_t tile_replace_scalar(const TileReplaceRule *rules, size_t ruleCount, uint16_t *entries, size_t count)
+{
+    size_t changed = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint16_t entry = entries[i];
+        if (!entry) continue;
+
+        for (size_t r = 0; r < ruleCount; ++r)
+        {
+            const auto &rule = rules[r];
+            if ((entry & rule.mask) != rule.match) continue;
+
+            uint16_t out = static_cast<uint16_t>((entry & ~rule.setMask) | rule.set);
+            changed += out != entry;
+            entries[i] = out;
+            break;
+        }
+    }
+
+    return changed;
+}
+
+#ifdef REPLACE_X86
+
+// Eight entries per step. Lanes that matched a rule, or hold the empty entry,
+// are masked out of the later rules, and the step ends early once all are.
+static size_t tile_replace_sse2(const TileReplaceRule *rules, size_t ruleCount, uint16_t *entries, size_t count)
+{
+    size_t changed = 0, i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i *>(entries + i));
+        __m128i done = _mm_cmpeq_epi16(e, _mm_setzero_si128());
+        __m128i out = e;
+
+        for (size_t r = 0; r < ruleCount && _mm_movemask_epi8(done) != 0xFFFF; ++r)
+        {
+            const auto &rule = rules[r];
+            __m128i hit = _mm_cmpeq_epi16(_mm_and_si128(e, _mm_set1_epi16(static_cast<short>(rule.mask))), _mm_set1_epi16(static_cast<short>(rule.match)));
+            hit = _mm_andnot_si128(done, hit);
+
+            __m128i set = _mm_or_si128(_mm_andnot_si128(_mm_set1_epi16(static_cast<short>(rule.setMask)), e), _mm_set1_epi16(static_cast<short>(rule.set)));
+            out = _mm_or_si128(_mm_andnot_si128(hit, out), _mm_and_si128(hit, set));
+            done = _mm_or_si128(done, hit);
+        }
+
+        // Two mask bits per differing lane.
+        changed += std::popcount(static_cast<unsigned>(~_mm_movemask_epi8(_mm_cmpeq_epi16(out, e)) & 0xFFFF)) / 2;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(entries + i), out);
+    }
+
+    return changed + tile_replace_scalar(rules, ruleCount, entries + i, count - i);
+}
+
+// Same as above with sixteen entries per step.
+REPLACE_TARGET("avx2")
+static size_t tile_replace_avx2(const TileReplaceRule *rules, size_t ruleCount, uint16_t *entries, size_t count)
+{
+    size_t changed = 0, i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(entries + i));
+        __m256i done = _mm256_cmpeq_epi16(e, _mm256_setzero_si256());
+        __m256i out = e;
+
+        for (size_t r = 0; r < ruleCount && static_cast<unsigned>(_mm256_movemask_epi8(done)) != 0xFFFFFFFFu; ++r)
+        {
+            const auto &rule = rules[r];
+            __m256i hit = _mm256_cmpeq_epi16(_mm256_and_si256(e, _mm256_set1_epi16(static_cast<short>(rule.mask))), _mm256_set1_epi16(static_cast<short>(rule.match)));
+            hit = _mm256_andnot_si256(done, hit);
+
+            __m256i set = _mm256_or_si256(_mm256_andnot_si256(_mm256_set1_epi16(static_cast<short>(rule.setMask)), e), _mm256_set1_epi16(static_cast<short>(rule.set)));
+            out = _mm256_blendv_epi8(out, set, hit);
+            done = _mm256_or_si256(done, hit);
+        }
+
+        changed += std::popcount(~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(out, e)))) / 2;
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(entries + i), out);
+    }
+
+    return changed + tile_replace_scalar(rules, ruleCount, entries + i, count - i);
+}
+
+static bool tile_replace_has_avx2(void)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+
+    // AVX2 also needs the OS to save the upper register halves.
+    bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osAvx && (info[1] & (1 << 5));
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+using TileReplaceKernel = size_t (*)(const TileReplaceRule *, size_t, uint16_t *, size_t);
+
+struct ReplaceKernel
+{
+    TileReplaceKernel run;
+    const char *name;
+};
+
+static const ReplaceKernel &tile_replace_kernel(void)
+{
+    static const ReplaceKernel sKernel = [] {
+#ifdef REPLACE_X86
+        if (tile_replace_has_avx2()) return ReplaceKernel{ tile_replace_avx2, "AVX2" };
+        return ReplaceKernel{ tile_replace_sse2, "SSE2" };
+#else
+        return ReplaceKernel{ tile_replace_scalar, "Scalar" };
+#endif
+    }();
+
+    return sKernel;
+}
+
+const char *tile_replace_kernel_name(void)
+{
+    return tile_replace_kernel().name;
+}
+
+size_t tile_replace_entries(const std::vector<TileReplaceRule> &rules, uint16_t *entries, size_t count)
+{
+    if (rules.empty())
+        return 0;
+
+    return tile_replace_kernel().run(rules.data(), rules.size(), entries, count);
+}
+
+static void swap_entries(uint16_t *entries, size_t count)
+{
+    if constexpr (std::endian::native == std::endian::big)
+    {
+        for (size_t i = 0; i < count; ++i)
+            entries[i] = static_cast<uint16_t>((entries[i] >> 8) | (entries[i] << 8));
+    }
+}
+
+static const char *tile_replace_file(const std::string &path, const std::vector<TileReplaceRule> &rules, bool dryRun, size_t &changed)
+{
+    std::vector<uint16_t> entries;
+    changed = 0;
+
+    {
+        MappedFile file;
+        if (!file_map(file, path))
+            return "Could not open tilemap file.";
+
+        if (file.size % 2 != 0)
+            return "Tilemap file size must be a multiple of 2 bytes.";
+
+        entries.resize(file.size / 2);
+        memcpy(entries.data(), file.data, file.size);
+    }
+
+    swap_entries(entries.data(), entries.size());
+    changed = tile_replace_entries(rules, entries.data(), entries.size());
+
+    if (!changed || dryRun)
+        return nullptr;
+
+    swap_entries(entries.data(), entries.size());
+
+    if (!file_write_atomic(path, entries.data(), entries.size() * 2))
+        return "Could not write tilemap file.";
+
+    return nullptr;
+}
+
+const char *tile_replace_project(const std::string &root, const std::vector<TileReplaceRule> &rules, bool dryRun,
+                                 TileReplaceStats &stats, std::vector<std::string> &failures)
+{
+    stats = TileReplaceStats();
+    failures.clear();
+
+    std::error_code ec;
+    std::vector<std::string> paths;
+
+    for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        if (it->is_regular_file(ec) && file_extension(it->path().string()) == ".bin")
+            paths.push_back(it->path().string());
+    }
+
+    if (ec)
+        return "Could not scan the project directory.";
+
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<size_t> changed(paths.size());
+    std::vector<const char *> errors(paths.size());
+
+    thread_pool_parallel_for(paths.size(), [&](size_t i) {
+        errors[i] = tile_replace_file(paths[i], rules, dryRun, changed[i]);
+    });
+
+    stats.maps = paths.size();
+
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (errors[i])
+        {
+            failures.push_back(paths[i] + ": " + errors[i]);
+            ++stats.failed;
+            continue;
+        }
+
+        stats.changed += changed[i] > 0;
+        stats.entries += changed[i];
+
+        if (changed[i])
+            stats.changedPaths.push_back(paths[i]);
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Matches entries whose bits under mask equal match, then overwrites the bits
+// under setMask with set. Both use the Mask layout: tile index, flips and
+// the palette in the top nibble.
+struct TileReplaceRule
+{
+    uint16_t mask = 0, match = 0;
+    uint16_t setMask = 0, set = 0;
+};
+
+struct TileReplaceStats
+{
+    size_t maps = 0, changed = 0, failed = 0;
+    size_t entries = 0; // Rewritten entries over all maps.
+    std::vector<std::string> changedPaths; // Sorted, also filled for a dry run.
+};
+
+// One rule per line, a pattern and a replacement separated by "->", each a
+// list of tile=, palette=, flipx= and flipy= fields, e.g.
+//   tile=0x12 palette=3 -> tile=0x40
+// Numbers may be hex. An empty pattern matches every entry. Entry 0, the
+// empty cell, is never replaced, so a pattern for tile 0 that would match it,
+// e.g. tile=0 on its own, is an error. Blank lines and lines starting with
+// '#' are skipped.
+const char *tile_replace_parse(const std::string &text, std::vector<TileReplaceRule> &rules, size_t &errorLine);
+const char *tile_replace_load(const std::string &path, std::vector<TileReplaceRule> &rules, size_t &errorLine);
+
+// Applies the first matching rule to every entry and returns how many
+// changed. Entry 0, the empty cell, is left alone.
+size_t tile_replace_entries(const std::vector<TileReplaceRule> &rules, uint16_t *entries, size_t count);
+const char *tile_replace_kernel_name(void);
+
+// Rewrites every .bin below root in parallel. Maps that no rule changes are
+// not written; the others are replaced atomically unless dryRun is set.
+// Returns nullptr on success, otherwise a description of the error.
+const char *tile_replace_project(const std::string &root, const std::vector<TileReplaceRule> &rules, bool dryRun,
+                                 TileReplaceStats &stats, std::vector<std::string> &failures);
@@ -0,0 +1,65 @@
+#include "TileUsage.h"
+#include "Tilemap.h"
+#include "Utils.h"
+
+static void tile_usage_insert(std::vector<uint32_t> &list, std::vector<uint32_t> &slots, uint32_t cell)
+{
+    slots[cell] = static_cast<uint32_t>(list.size());
+    list.push_back(cell);
+}
+
+// Swaps the last cell into the freed slot.
+static void tile_usage_erase(std::vector<uint32_t> &list, std::vector<uint32_t> &slots, uint32_t cell)
+{
+    uint32_t slot = slots[cell];
+    uint32_t last = list.back();
+
+    list[slot] = last;
+    slots[last] = slot;
+    list.pop_back();
+    slots[cell] = TileUsage::NoSlot;
+}
+
+void tile_usage_build(TileUsage &usage, const Tilemap &tilemap)
+{
+    static constexpr int sSize = TilemapChunk::Size;
+
+    size_t cells = static_cast<size_t>(tilemap.width) * tilemap.height;
+
+    usage.width = tilemap.width;
+    usage.tileSlots.assign(cells, TileUsage::NoSlot);
+    usage.paletteSlots.assign(cells, TileUsage::NoSlot);
+
+    for (auto &list : usage.tiles) list.clear();
+    for (auto &list : usage.palettes) list.clear();
+
+    for (int cy = 0; cy < tilemap.chunksY; ++cy)
+    for (int cx = 0; cx < tilemap.chunksX; ++cx)
+    {
+        auto *chunk = tilemap_get_chunk(tilemap, cx + cy * tilemap.chunksX);
+        if (!chunk) continue;
+
+        for (int y = 0; y < sSize && cy * sSize + y < tilemap.height; ++y)
+        for (int x = 0; x < sSize && cx * sSize + x < tilemap.width; ++x)
+        {
+            unsigned short entry = chunk->tiles[x + y * sSize];
+            if (entry)
+                tile_usage_update(usage, (cx * sSize + x) + (cy * sSize + y) * tilemap.width, 0, entry);
+        }
+    }
+}
+
+void tile_usage_update(TileUsage &usage, uint32_t cell, unsigned short oldEntry, unsigned short newEntry)
+{
+    if (oldEntry)
+    {
+        tile_usage_erase(usage.tiles[oldEntry & Mask::Index], usage.tileSlots, cell);
+        tile_usage_erase(usage.palettes[oldEntry >> 12], usage.paletteSlots, cell);
+    }
+
+    if (newEntry)
+    {
+        tile_usage_insert(usage.tiles[newEntry & Mask::Index], usage.tileSlots, cell);
+        tile_usage_insert(usage.palettes[newEntry >> 12], usage.paletteSlots, cell);
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct Tilemap;
+
+// Reverse index of one tilemap: the cells using each tile index and each
+// palette, as x + y * width. Empty cells (entry 0) are not recorded. The
+// lists are unordered and every cell remembers its position in them, so an
+// edit costs O(1) no matter how often a tile is used.
+struct TileUsage
+{
+    static constexpr uint32_t NoSlot = ~0u;
+
+    int width = 0;
+    std::vector<uint32_t> tiles[1024];
+    std::vector<uint32_t> palettes[16];
+    std::vector<uint32_t> tileSlots, paletteSlots;
+};
+
+void tile_usage_build(TileUsage &usage, const Tilemap &tilemap);
+void tile_usage_update(TileUsage &usage, uint32_t cell, unsigned short oldEntry, unsigned short newEntry);
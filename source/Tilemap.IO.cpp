@@ -0,0 +1,132 @@
+#include "Tilemap.IO.h"
+#include "Tilemap.h"
+#include "Compression.h"
+#include "File.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+// 4096x4096 tiles, well past any GBA or composite map.
+static constexpr size_t sMaxEntries = 4096 * 4096;
+
+static void swap_entries(unsigned short *entries, size_t count)
+{
+    if constexpr (std::endian::native == std::endian::big)
+    {
+        for (size_t i = 0; i < count; ++i)
+            entries[i] = static_cast<unsigned short>((entries[i] >> 8) | (entries[i] << 8));
+    }
+}
+
+// Maps are stored screenblock by screenblock, which matches the GBA layout
+// for every hardware background size. Screenblocks that are entirely zero
+// are left unallocated.
+const char *tilemap_read(Tilemap &tilemap, const unsigned char *data, size_t size, int widthHint, int heightHint)
+{
+    static constexpr size_t sChunkBytes = TilemapChunk::Area * 2;
+
+    if (size == 0)
+        return "Tilemap file is empty.";
+
+    if (size % 2 != 0)
+        return "Tilemap file size must be a multiple of 2 bytes.";
+
+    if (size / 2 > sMaxEntries)
+        return "Tilemap file is too large.";
+
+    size_t blocks = (size + sChunkBytes - 1) / sChunkBytes;
+    int width = widthHint, height = heightHint;
+
+    if (width <= 0 || height <= 0 || static_cast<size_t>(((width + TilemapChunk::Size - 1) / TilemapChunk::Size) * ((height + TilemapChunk::Size - 1) / TilemapChunk::Size)) != blocks)
+        tilemap_guess_size(size / 2, width, height);
+
+    tilemap_create(tilemap, width, height);
+
+    for (size_t c = 0; c < blocks; ++c)
+    {
+        const unsigned char *src = data + c * sChunkBytes;
+        size_t bytes = std::min(size - c * sChunkBytes, sChunkBytes);
+
+        if (std::all_of(src, src + bytes, [](unsigned char b) { return b == 0; }))
+            continue;
+
+        auto &chunk = tilemap_touch_chunk(tilemap, static_cast<int>(c));
+        memcpy(chunk.tiles, src, bytes);
+        swap_entries(chunk.tiles, bytes / 2);
+        chunk.dirtyTiles.set();
+    }
+
+    return nullptr;
+}
+
+const char *tilemap_load_file(Tilemap &tilemap, const std::string &path, int widthHint, int heightHint)
+{
+    // Compressed maps are decoded into memory, raw ones read from the mapping.
+    if (compression_from_path(path) != Compression::None)
+    {
+        std::vector<unsigned char> data;
+        if (const char *error = compression_load_file(path, data))
+            return error;
+
+        return tilemap_read(tilemap, data.data(), data.size(), widthHint, heightHint);
+    }
+
+    MappedFile file;
+
+    if (!file_map(file, path))
+        return "Could not open tilemap file.";
+
+    return tilemap_read(tilemap, file.data, file.size, widthHint, heightHint);
+}
+
+std::vector<unsigned char> tilemap_write(const Tilemap &tilemap)
+{
+    static constexpr size_t sChunkBytes = TilemapChunk::Area * 2;
+
+    std::vector<unsigned char> data(tilemap.chunks.size() * sChunkBytes);
+
+    for (size_t c = 0; c < tilemap.chunks.size(); ++c)
+    {
+        if (!tilemap.chunks[c]) continue;
+
+        auto *dst = reinterpret_cast<unsigned short *>(data.data() + c * sChunkBytes);
+        memcpy(dst, tilemap.chunks[c]->tiles, sChunkBytes);
+        swap_entries(dst, TilemapChunk::Area);
+    }
+
+    return data;
+}
+
+const char *tilemap_save_file(const Tilemap &tilemap, const std::string &path)
+{
+    auto data = tilemap_write(tilemap);
+
+    if (compression_from_path(path) != Compression::None)
+        return compression_save_file(path, data.data(), data.size());
+
+    if (!file_write_atomic(path, data.data(), data.size()))
+        return "Could not write tilemap file.";
+
+    return nullptr;
+}
+
+void tilemap_load_files(const std::vector<std::string> &paths, std::vector<Tilemap> &tilemaps, std::vector<const char *> &errors)
+{
+    tilemaps.resize(paths.size());
+    errors.assign(paths.size(), nullptr);
+
+    thread_pool_parallel_for(paths.size(), [&](size_t i) {
+        errors[i] = tilemap_load_file(tilemaps[i], paths[i]);
+    });
+}
+
+void tilemap_save_files(const std::vector<std::string> &paths, const std::vector<Tilemap> &tilemaps, std::vector<const char *> &errors)
+{
+    errors.assign(paths.size(), nullptr);
+
+    thread_pool_parallel_for(paths.size(), [&](size_t i) {
+        errors[i] = tilemap_save_file(tilemaps[i], paths[i]);
+    });
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct Tilemap;
+
+// All functions return nullptr on success, otherwise a description of the error.
+const char *tilemap_read(Tilemap &tilemap, const unsigned char *data, size_t size, int widthHint = 0, int heightHint = 0);
+const char *tilemap_load_file(Tilemap &tilemap, const std::string &path, int widthHint = 0, int heightHint = 0);
+std::vector<unsigned char> tilemap_write(const Tilemap &tilemap);
+const char *tilemap_save_file(const Tilemap &tilemap, const std::string &path);
+
+void tilemap_load_files(const std::vector<std::string> &paths, std::vector<Tilemap> &tilemaps, std::vector<const char *> &errors);
+void tilemap_save_files(const std::vector<std::string> &paths, const std::vector<Tilemap> &tilemaps, std::vector<const char *> &errors);
@@ -0,0 +1,143 @@
+#include "Tilemap.h"
+
+#include <algorithm>
+#include <cmath>
+
+static int chunk_count(int tiles)
+{
+    return (tiles + TilemapChunk::Size - 1) / TilemapChunk::Size;
+}
+
+void tilemap_create(Tilemap &tilemap, int width, int height)
+{
+    tilemap.width = width;
+    tilemap.height = height;
+    tilemap.chunksX = chunk_count(width);
+    tilemap.chunksY = chunk_count(height);
+    tilemap.chunks.clear();
+    tilemap.chunks.resize(tilemap.chunksX * tilemap.chunksY);
+    tilemap.dirty = true;
+    tilemap.usage.reset();
+}
+
+// Keeps the overlapping area. Tiles that fall outside the new bounds are
+// cleared so that growing the map again does not bring them back.
+void tilemap_resize(Tilemap &tilemap, int width, int height)
+{
+    Tilemap resized;
+    tilemap_create(resized, width, height);
+
+    for (int cy = 0; cy < std::min(tilemap.chunksY, resized.chunksY); ++cy)
+    for (int cx = 0; cx < std::min(tilemap.chunksX, resized.chunksX); ++cx)
+    {
+        auto &chunk = tilemap.chunks[cx + cy * tilemap.chunksX];
+        if (!chunk) continue;
+
+        for (int y = 0; y < TilemapChunk::Size; ++y)
+        for (int x = 0; x < TilemapChunk::Size; ++x)
+        {
+            if (!tilemap_contains(resized, cx * TilemapChunk::Size + x, cy * TilemapChunk::Size + y))
+                chunk->tiles[x + y * TilemapChunk::Size] = 0;
+        }
+
+        chunk->dirtyTiles.set();
+        resized.chunks[cx + cy * resized.chunksX] = std::move(chunk);
+    }
+
+    tilemap = std::move(resized);
+}
+
+bool tilemap_contains(const Tilemap &tilemap, int x, int y)
+{
+    return x >= 0 && y >= 0 && x < tilemap.width && y < tilemap.height;
+}
+
+unsigned short tilemap_get(const Tilemap &tilemap, int x, int y)
+{
+    if (!tilemap_contains(tilemap, x, y))
+        return 0;
+
+    auto *chunk = tilemap_get_chunk(tilemap, (x / TilemapChunk::Size) + (y / TilemapChunk::Size) * tilemap.chunksX);
+    return chunk ? chunk->tiles[(x % TilemapChunk::Size) + (y % TilemapChunk::Size) * TilemapChunk::Size] : 0;
+}
+
+void tilemap_set(Tilemap &tilemap, int x, int y, unsigned short tile)
+{
+    if (!tilemap_contains(tilemap, x, y))
+        return;
+
+    int chunkIdx = (x / TilemapChunk::Size) + (y / TilemapChunk::Size) * tilemap.chunksX;
+    int i = (x % TilemapChunk::Size) + (y % TilemapChunk::Size) * TilemapChunk::Size;
+
+    auto *chunk = tilemap_get_chunk(tilemap, chunkIdx);
+
+    if (!chunk)
+    {
+        if (tile == 0) return;
+        chunk = &tilemap_touch_chunk(tilemap, chunkIdx);
+    }
+
+    if (chunk->tiles[i] == tile)
+        return;
+
+    if (tilemap.usage)
+        tile_usage_update(*tilemap.usage, x + y * tilemap.width, chunk->tiles[i], tile);
+
+    chunk->tiles[i] = tile;
+    chunk->dirtyTiles.set(i);
+    tilemap.dirty = true;
+}
+
+const TileUsage &tilemap_usage(Tilemap &tilemap)
+{
+    if (!tilemap.usage)
+    {
+        tilemap.usage = std::make_unique<TileUsage>();
+        tile_usage_build(*tilemap.usage, tilemap);
+    }
+
+    return *tilemap.usage;
+}
+
+TilemapChunk *tilemap_get_chunk(const Tilemap &tilemap, int chunk)
+{
+    return tilemap.chunks[chunk].get();
+}
+
+TilemapChunk &tilemap_touch_chunk(Tilemap &tilemap, int chunk)
+{
+    auto &ptr = tilemap.chunks[chunk];
+
+    if (!ptr)
+        ptr = std::make_unique<TilemapChunk>();
+
+    return *ptr;
+}
+
+// Raw maps carry no header, so the size is inferred from the entry count
+// using the GBA background sizes, falling back to a square of screenblocks.
+void tilemap_guess_size(size_t entries, int &width, int &height)
+{
+    static constexpr int sArea = TilemapChunk::Area;
+
+    size_t blocks = std::max<size_t>((entries + sArea - 1) / sArea, 1);
+
+    switch (blocks)
+    {
+    case 1: width = 32; height = 32; return;
+    case 2: width = 64; height = 32; return;
+    case 4: width = 64; height = 64; return;
+    }
+
+    int side = static_cast<int>(std::sqrt(static_cast<double>(blocks)));
+
+    if (static_cast<size_t>(side) * side == blocks)
+    {
+        width = height = side * TilemapChunk::Size;
+    }
+    else
+    {
+        width = TilemapChunk::Size;
+        height = static_cast<int>(blocks) * TilemapChunk::Size;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "TileUsage.h"
+
+#include <bitset>
+#include <memory>
+#include <vector>
+
+// One GBA screenblock. Chunks are allocated the first time a tile inside them
+// is written; unallocated chunks read back as zero.
+struct TilemapChunk
+{
+    static constexpr int Size = 32;
+    static constexpr int Area = Size * Size;
+
+    unsigned short tiles[Area]{};
+    std::bitset<Area> dirtyTiles;
+};
+
+struct Tilemap
+{
+    int width = 0, height = 0;
+    int chunksX = 0, chunksY = 0;
+    std::vector<std::unique_ptr<TilemapChunk>> chunks;
+
+    // Set whenever a tile changes, cleared by the renderer.
+    bool dirty = true;
+
+    // Built by tilemap_usage() and from then on kept up to date by
+    // tilemap_set(). Creating or resizing the map drops it.
+    std::unique_ptr<TileUsage> usage;
+};
+
+void tilemap_create(Tilemap &tilemap, int width, int height);
+void tilemap_resize(Tilemap &tilemap, int width, int height);
+bool tilemap_contains(const Tilemap &tilemap, int x, int y);
+unsigned short tilemap_get(const Tilemap &tilemap, int x, int y);
+void tilemap_set(Tilemap &tilemap, int x, int y, unsigned short tile);
+const TileUsage &tilemap_usage(Tilemap &tilemap);
+TilemapChunk *tilemap_get_chunk(const Tilemap &tilemap, int chunk);
+TilemapChunk &tilemap_touch_chunk(Tilemap &tilemap, int chunk);
+void tilemap_guess_size(size_t entries, int &width, int &height);
@@ -0,0 +1,123 @@
+#include "Tileset.h"
+#include "Compression.h"
+#include "File.h"
+#include "Png.h"
+
+#include <algorithm>
+#include <cstring>
+
+static bool tileset_is_png(const std::string &path)
+{
+    return file_extension(path) == ".png";
+}
+
+void tileset_pack_tile(const unsigned char *pixels, unsigned char *tile)
+{
+    for (int i = 0; i < Tileset::TileBytes; ++i)
+        tile[i] = static_cast<unsigned char>((pixels[i * 2] & 0xF) | ((pixels[i * 2 + 1] & 0xF) << 4));
+}
+
+void tileset_unpack_tile(const unsigned char *tile, unsigned char *pixels)
+{
+    for (int i = 0; i < Tileset::TileBytes; ++i)
+    {
+        pixels[i * 2] = tile[i] & 0xF;
+        pixels[i * 2 + 1] = tile[i] >> 4;
+    }
+}
+
+// A short file leaves the rest of the sheet empty.
+static const char *tileset_decode_4bpp(const std::string &path, TileSheet &sheet)
+{
+    std::vector<unsigned char> data;
+    if (const char *error = compression_load_file(path, data))
+        return error;
+
+    if (data.size() % Tileset::TileBytes != 0)
+        return "Tile data size must be a multiple of 32 bytes.";
+
+    if (data.size() > sizeof(sheet.tiles))
+        return "Tile data holds more than 512 tiles.";
+
+    memcpy(sheet.tiles, data.data(), data.size());
+    memset(reinterpret_cast<unsigned char *>(sheet.tiles) + data.size(), 0, sizeof(sheet.tiles) - data.size());
+    sheet.palette.clear();
+    return nullptr;
+}
+
+static const char *tileset_decode_png(const std::string &path, TileSheet &sheet)
+{
+    IndexedImage image;
+    if (const char *error = png_load_indexed(path, image))
+        return error;
+
+    if (image.width != Tileset::SheetWidth || image.height != Tileset::SheetHeight)
+        return "Tileset must be 128x256 pixels.";
+
+    // 8bpp and grayscale sheets decode fine, but only 16 colors fit a tile.
+    if (std::any_of(image.pixels.begin(), image.pixels.end(), [](unsigned char index) { return index > 15; }))
+        return "Color index out of range for 4bpp.";
+
+    for (int t = 0; t < Tileset::SheetTiles; ++t)
+    {
+        const unsigned char *src = image.pixels.data() + (t / 16) * 8 * Tileset::SheetWidth + (t % 16) * 8;
+        unsigned char pixels[64];
+
+        for (int py = 0; py < 8; ++py)
+            memcpy(pixels + py * 8, src + py * Tileset::SheetWidth, 8);
+
+        tileset_pack_tile(pixels, sheet.tiles[t]);
+    }
+
+    sheet.palette = std::move(image.palette);
+    return nullptr;
+}
+
+const char *tileset_decode_sheet(const std::string &path, TileSheet &sheet)
+{
+    return tileset_is_png(path) ? tileset_decode_png(path, sheet) : tileset_decode_4bpp(path, sheet);
+}
+
+// Raw tile data drops trailing empty tiles; they read back as empty anyway.
+const char *tileset_save_sheet(const std::string &path, const TileSheet &sheet)
+{
+    if (!tileset_is_png(path))
+    {
+        size_t used = Tileset::SheetTiles;
+        while (used > 1 && std::all_of(sheet.tiles[used - 1], sheet.tiles[used], [](unsigned char b) { return b == 0; }))
+            --used;
+
+        return compression_save_file(path, sheet.tiles[0], used * Tileset::TileBytes);
+    }
+
+    IndexedImage image;
+    image.width = Tileset::SheetWidth;
+    image.height = Tileset::SheetHeight;
+    image.pixels.resize(Tileset::SheetWidth * Tileset::SheetHeight);
+    image.palette = sheet.palette;
+
+    for (int t = 0; t < Tileset::SheetTiles; ++t)
+    {
+        unsigned char *dst = image.pixels.data() + (t / 16) * 8 * Tileset::SheetWidth + (t % 16) * 8;
+        unsigned char pixels[64];
+        tileset_unpack_tile(sheet.tiles[t], pixels);
+
+        for (int py = 0; py < 8; ++py)
+            memcpy(dst + py * Tileset::SheetWidth, pixels + py * 8, 8);
+    }
+
+    return png_save_indexed(path, image);
+}
+
+void tileset_load_sheet(Tileset &tileset, const TileSheet &sheet, bool secondary)
+{
+    memcpy(tileset.tiles[secondary ? Tileset::SheetTiles : 0], sheet.tiles, sizeof(sheet.tiles));
+    tileset.sheetPalettes[secondary] = sheet.palette;
+    tileset.sheetLoaded[secondary] = true;
+}
+
+void tileset_store_sheet(const Tileset &tileset, bool secondary, TileSheet &sheet)
+{
+    memcpy(sheet.tiles, tileset.tiles[secondary ? Tileset::SheetTiles : 0], sizeof(sheet.tiles));
+    sheet.palette = tileset.sheetPalettes[secondary];
+}
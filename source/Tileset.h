@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// CPU copy of both tileset sheets in the GBA VRAM layout: 32 bytes per tile,
+// four bytes per row, two pixels per byte with the left one in the low
+// nibble. Tiles 0-511 come from the primary sheet and tiles 512-1023 from
+// the secondary sheet, matching the tile index in map entries.
+struct Tileset
+{
+    static constexpr int SheetWidth = 128, SheetHeight = 256;
+    static constexpr int SheetTiles = (SheetWidth / 8) * (SheetHeight / 8);
+    static constexpr int TileCount = SheetTiles * 2;
+    static constexpr int TileBytes = 32;
+
+    unsigned char tiles[TileCount][TileBytes]{};
+
+    // PLTE of each source PNG, written back when a sheet is exported.
+    std::vector<unsigned char> sheetPalettes[2];
+    bool sheetLoaded[2]{};
+};
+
+// One sheet in the same packed layout, tiles running left to right and top
+// to bottom over the 128x256 sheet.
+struct TileSheet
+{
+    unsigned char tiles[Tileset::SheetTiles][Tileset::TileBytes]{};
+    std::vector<unsigned char> palette;
+};
+
+inline int tileset_pixel(const unsigned char *tile, int x, int y)
+{
+    return (tile[y * 4 + x / 2] >> ((x & 1) * 4)) & 0xF;
+}
+
+// Convert between a packed tile and 64 indices, one byte per pixel.
+void tileset_pack_tile(const unsigned char *pixels, unsigned char *tile);
+void tileset_unpack_tile(const unsigned char *tile, unsigned char *pixels);
+
+// Loads a sheet from a 128x256 PNG of 4bpp indices, or from raw GBA tile
+// data with any other extension, compressed if it ends in .lz or .rl. Raw
+// data is copied as is. Returns nullptr on success, otherwise a description
+// of the error.
+const char *tileset_decode_sheet(const std::string &path, TileSheet &sheet);
+const char *tileset_save_sheet(const std::string &path, const TileSheet &sheet);
+void tileset_load_sheet(Tileset &tileset, const TileSheet &sheet, bool secondary);
+void tileset_store_sheet(const Tileset &tileset, bool secondary, TileSheet &sheet);
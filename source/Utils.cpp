@@ -3,174 +3,190 @@
 #include "Global.h"
 #include "FileDialog.h"
 #include "ActionStack.h"
-
-#include <stb_image.h>
+#include "AssetLoader.h"
+#include "Tilemap.IO.h"
+#include "Palette.h"
+#include "TileOptimizer.h"
+#include "TileReplace.h"
+#include "Profiler.h"
 
 #include <string>
 #include <vector>
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
+#include <cstring>
 
-static constexpr char sText_JASC_PAL[] = "JASC-PAL";
-static constexpr char sText_PAL_0100[] = "0100";
-
-std::vector<Color> load_palette(const std::string &fname)
+void load_tilemap_from_file(const std::string &fname)
 {
-    std::ifstream stream(fname);
-    std::vector<Color> colors;
-    std::string line;
+    Tilemap tilemap;
 
-    uint16_t num_colors;
-    int r, g, b;
+    if (const char *error = tilemap_load_file(tilemap, fname, global.document->tilemap.width, global.document->tilemap.height))
+    {
+        global.statusText = error;
+        return;
+    }
 
-    stream >> line;
-    if (line != sText_JASC_PAL) 
-        throw ("Invalid JASC-PAL signature.");
+    JournalState journal;
+    const char *error = journal_replay(fname, tilemap, journal);
 
-    stream >> line;
-    if (line != sText_PAL_0100) 
-        throw ("Unsupported JASC-PAL version.");
+    auto &doc = document_create_or_reuse();
+    doc.path = fname;
+    doc.tilemap = std::move(tilemap);
+    doc.selection.clear();
+    global.statusText.clear();
+    action_stack_clear();
+    document_attach_journal(doc, journal);
+    renderer_invalidate_map(doc.view);
 
-    if (!(stream >> num_colors))
-        throw ("Could not parse number of colors.");
+    if (error)
+        global.statusText = error;
+}
 
-    if (num_colors < 1 || num_colors > 256)
-        throw ("Unsupported number of colors. (Color count must be between 1 and 256)");
+// Everything journaled so far is now in the file.
+void save_tilemap_to_file(const std::string &fname)
+{
+    auto &doc = *global.document;
+    const char *error = tilemap_save_file(doc.tilemap, fname);
 
-    for (int i = 0; i < num_colors; i++)
-    {
-        if (!(stream >> r >> g >> b))
-            throw ("Error parsing color components.");
+    global.statusText = error ? error : "";
 
-        if (r < 0 || g < 0 || b < 0 || r > 255 || g > 255 || b > 255)
-            throw ("Color component value must be between 0 and 255.");
+    if (!error)
+        document_compact_journal(doc, fname);
+}
 
-        colors.push_back({ 
-            static_cast<unsigned char>(r), 
-            static_cast<unsigned char>(g), 
-            static_cast<unsigned char>(b) 
-        });
-    }
+void resize_tilemap(int width, int height)
+{
+    if (width < 1 || height < 1)
+        return;
 
-    stream.close();
+    action_stack_clear();
+    tilemap_resize(global.document->tilemap, width, height);
+    global.document->selection.clear();
+    global.document->unsaved = true;
 
-    return colors;
+    if (const char *error = journal_snapshot(global.document->journal, global.document->tilemap))
+        global.statusText = error;
+
+    renderer_invalidate_map(global.document->view);
 }
 
-void load_tilemap_from_file(const std::string &fname)
+static void load_tileset_sheet(const std::string &fname, bool secondary)
 {
-    std::ifstream fs(fname, std::ios::binary);
+    TileSheet sheet;
+    const char *error = tileset_decode_sheet(fname, sheet);
 
-    for (int i = 0; i < 0x400; ++i)
+    if (!error)
     {
-        uint16_t entry;
-        fs.read(reinterpret_cast<char *>(&entry), 2);
-        global.tilemap[i] = entry;
+        Tileset tileset = global.document->tileset->tileset;
+        tileset_load_sheet(tileset, sheet, secondary);
+        document_set_tileset(*global.document, tileset);
     }
 
-    fs.close();
+    global.statusText = error ? error : "";
 }
 
-void save_tilemap_to_file(const std::string &fname)
+void load_primary_tileset(const std::string &fname)
 {
-    std::ofstream fs(fname, std::ios::binary | std::ios::trunc);
+    load_tileset_sheet(fname, false);
+}
 
-    for (unsigned short entry : global.tilemap)
-        fs.write(reinterpret_cast<char *>(&entry), 2);
+void load_secondary_tileset(const std::string &fname)
+{
+    load_tileset_sheet(fname, true);
 }
 
-void load_primary_tileset(const std::string &fname)
+void load_palettes(const std::string &s)
 {
-    int w, h, n;
-    stbi_set_flip_vertically_on_load(1);
-    unsigned char *data = stbi_load(fname.c_str(), &w, &h, &n, 4);
+    const auto &current = *global.document->palettes;
 
-    if (!data || w != 128 || h != 256 || n != 1)
-    {
-        stbi_image_free(data);
-        return;
-    }
+    Palette palettes[16];
+    memcpy(palettes, current.palettes, sizeof(palettes));
+
+    const char *error = nullptr;
+    unsigned int loaded = palette_load_directory(s, palettes, &error);
 
-    renderer_load_primary(global.renderer, data);
-    stbi_image_free(data);
+    global.statusText = error ? error : "";
+    document_set_palettes(*global.document, palettes, current.loadedMask | loaded);
 }
 
-void load_secondary_tileset(const std::string &fname)
+// Folds duplicate and flipped tiles of the loaded sheets, rewrites the open
+// tilemap and the brush to match, then offers to save the compacted sheets.
+void optimize_tileset(void)
 {
-    int w, h, n;
-    stbi_set_flip_vertically_on_load(1);
-    unsigned char *data = stbi_load(fname.c_str(), &w, &h, &n, 4);
+    auto &doc = *global.document;
+    Tileset tileset = doc.tileset->tileset;
 
-    if (!data || w != 128 || h != 256 || n != 1)
+    if (!tileset.sheetLoaded[0] && !tileset.sheetLoaded[1])
     {
-        stbi_image_free(data);
+        global.statusText = "Load a tileset first.";
         return;
     }
 
-    renderer_load_secondary(global.renderer, data);
-    stbi_image_free(data);
-}
+    TileRemap remap;
+    int removed = tile_optimizer_run(tileset, remap);
 
+    tile_optimizer_remap(doc.tilemap, remap);
 
-static const char gPaletteFileNames[][7] =
-{
-    "00.pal",
-    "01.pal",
-    "02.pal",
-    "03.pal",
-    "04.pal",
-    "05.pal",
-    "06.pal",
-    "07.pal",
-    "08.pal",
-    "09.pal",
-    "10.pal",
-    "11.pal",
-    "12.pal",
-    "13.pal",
-    "14.pal",
-    "15.pal"
-};
+    for (auto &tile : global.brush.selection)
+        tile = tile_optimizer_remap_entry(remap, tile);
 
-void load_palettes(const std::string &s)
-{
-    std::filesystem::path basePalettePath = s;
+    // Recorded deltas refer to the old tile indices. Other documents keep
+    // the old tileset, so their maps stay valid.
+    action_stack_clear();
+    document_set_tileset(doc, tileset);
+
+    global.statusText = "Removed " + std::to_string(removed) + " duplicate tiles.";
+    doc.unsaved = true;
+
+    if (const char *error = journal_snapshot(doc.journal, doc.tilemap))
+        global.statusText = error;
+
+    static const char *sNames[2] = { "Compacted Primary Tileset", "Compacted Secondary Tileset" };
 
-    for (int i = 0; i < 16; ++i)
+    for (int sheet = 0; sheet < 2; ++sheet)
     {
-        auto palPath = basePalettePath / gPaletteFileNames[i];
+        std::string s;
+        if (!tileset.sheetLoaded[sheet] || !FileDialog::Open(FileDialog::Mode::Save, { {sNames[sheet], "png"}, {"GBA Tiles", "4bpp,lz,rl"} }, s))
+            continue;
 
-        if (std::filesystem::exists(palPath))
-            renderer_load_palette(global.renderer, i, load_palette(palPath.string()).data());
+        TileSheet tiles;
+        tileset_store_sheet(tileset, sheet == 1, tiles);
+
+        if (const char *error = tileset_save_sheet(s, tiles))
+            global.statusText = error;
     }
+}
 
-    renderer_change_palette(global.renderer, global.brush.palette);
-    renderer_load_map_palette(global.renderer);
+void new_document(void)
+{
+    document_create();
+}
+
+void close_document(void)
+{
+    document_close(*global.document);
 }
 
 void open_tilemap(void)
 {
     std::string s;
-    if (FileDialog::Open(FileDialog::Mode::Open, { {"Parallax file", "bin"} }, s))
-    {
-        global.tilemapPath = s;
-        action_stack_clear();
-        load_tilemap_from_file(s);
-    }
+    if (FileDialog::Open(FileDialog::Mode::Open, { {"Parallax file", "bin"}, {"Compressed Tilemap", "lz,rl"} }, s))
+        asset_loader_load_tilemap(s);
 }
 
 void save_tilemap(void)
 {
-    if (global.tilemapPath.empty()) save_as_tilemap();
-    else save_tilemap_to_file(global.tilemapPath);
+    if (global.document->path.empty()) save_as_tilemap();
+    else save_tilemap_to_file(global.document->path);
 }
 
 void save_as_tilemap(void)
 {
     std::string s;
-    if (FileDialog::Open(FileDialog::Mode::Save, { {"Parallax File", "bin"} }, s))
+    if (FileDialog::Open(FileDialog::Mode::Save, { {"Parallax File", "bin"}, {"Compressed Tilemap", "lz,rl"} }, s))
     {
-        global.tilemapPath = s;
+        global.document->path = s;
         save_tilemap_to_file(s);
     }
 }
@@ -178,20 +194,168 @@ void save_as_tilemap(void)
 void open_primary_tileset(void)
 {
     std::string s;
-    if (FileDialog::Open(FileDialog::Mode::Open, { {"Primary Tileset", "png"} }, s))
-        load_primary_tileset(s);
+    if (FileDialog::Open(FileDialog::Mode::Open, { {"Primary Tileset", "png"}, {"GBA Tiles", "4bpp,lz,rl"} }, s))
+        asset_loader_load_tileset(s, false);
 }
 
 void open_secondary_tileset(void)
 {
     std::string s;
-    if (FileDialog::Open(FileDialog::Mode::Open, { {"Secondary Tileset", "png"} }, s))
-        load_secondary_tileset(s);
+    if (FileDialog::Open(FileDialog::Mode::Open, { {"Secondary Tileset", "png"}, {"GBA Tiles", "4bpp,lz,rl"} }, s))
+        asset_loader_load_tileset(s, true);
+}
+
+// Both sheets decode concurrently on the loader's workers.
+void open_tilesets(void)
+{
+    std::string primary, secondary;
+    if (FileDialog::Open(FileDialog::Mode::Open, { {"Primary Tileset", "png"}, {"GBA Tiles", "4bpp,lz,rl"} }, primary) &&
+        FileDialog::Open(FileDialog::Mode::Open, { {"Secondary Tileset", "png"}, {"GBA Tiles", "4bpp,lz,rl"} }, secondary))
+    {
+        asset_loader_load_tileset(primary, false);
+        asset_loader_load_tileset(secondary, true);
+    }
 }
 
 void open_palettes(void)
 {
     std::string s;
     if (FileDialog::Open(FileDialog::Mode::Folder, {}, s))
-        load_palettes(s);
-}
\ No newline at end of file
+        asset_loader_load_palettes(s);
+}
+
+void import_tilemap(void)
+{
+    std::string image, directory;
+    if (FileDialog::Open(FileDialog::Mode::Open, { {"Image", "png"} }, image) &&
+        FileDialog::Open(FileDialog::Mode::Folder, {}, directory))
+    {
+        asset_loader_import_image(image, directory);
+    }
+}
+
+void show_find_tile(void)
+{
+    global.showFindTile = true;
+}
+
+// Open documents showing one of the given files.
+static std::vector<Document *> documents_for_files(const std::vector<std::string> &paths)
+{
+    std::vector<Document *> docs;
+
+    for (auto &doc : global.documents)
+    {
+        std::error_code ec;
+
+        if (!doc->path.empty() && std::any_of(paths.begin(), paths.end(), [&](const std::string &path) { return std::filesystem::equivalent(doc->path, path, ec); }))
+            docs.push_back(doc.get());
+    }
+
+    return docs;
+}
+
+// Takes over a file that was rewritten behind the document's back. Only
+// done for documents without unsaved edits, which have nothing to lose.
+static const char *reload_document(Document &doc)
+{
+    Tilemap tilemap;
+    if (const char *error = tilemap_load_file(tilemap, doc.path, doc.tilemap.width, doc.tilemap.height))
+        return error;
+
+    doc.tilemap = std::move(tilemap);
+    doc.history = ActionHistory();
+    doc.selection.clear();
+    renderer_invalidate_map(doc.view);
+
+    if (!doc.journal.path.empty())
+        return journal_compact(doc.journal, doc.path, doc.tilemap);
+
+    return nullptr;
+}
+
+static std::string document_titles(const std::vector<Document *> &docs)
+{
+    std::string titles;
+
+    for (auto *doc : docs)
+        titles += (titles.empty() ? "" : ", ") + document_title(*doc);
+
+    return titles;
+}
+
+// Applies a replacement table to every map below a folder, the same as
+// ParallaxTool replace. Open tabs of maps it would change must not have
+// unsaved edits, since saving them later would undo the replacement; they
+// are reloaded afterwards.
+void replace_tiles_in_project(void)
+{
+    std::string root, table;
+    if (!FileDialog::Open(FileDialog::Mode::Folder, {}, root) ||
+        !FileDialog::Open(FileDialog::Mode::Open, { {"Replacement Table", "txt"} }, table))
+        return;
+
+    std::vector<TileReplaceRule> rules;
+    size_t line;
+    if (const char *error = tile_replace_load(table, rules, line))
+    {
+        global.statusText = line ? "Line " + std::to_string(line) + ": " + error : error;
+        return;
+    }
+
+    TileReplaceStats stats;
+    std::vector<std::string> failures;
+    if (const char *error = tile_replace_project(root, rules, true, stats, failures))
+    {
+        global.statusText = error;
+        return;
+    }
+
+    std::vector<Document *> unsaved;
+    for (auto *doc : documents_for_files(stats.changedPaths))
+    {
+        if (doc->unsaved)
+            unsaved.push_back(doc);
+    }
+
+    if (!unsaved.empty())
+    {
+        global.statusText = "Save or close these maps first, the replacement would change them: " + document_titles(unsaved) + ".";
+        return;
+    }
+
+    if (const char *error = tile_replace_project(root, rules, false, stats, failures))
+    {
+        global.statusText = error;
+        return;
+    }
+
+    std::vector<Document *> reloaded = documents_for_files(stats.changedPaths);
+    const char *reloadError = nullptr;
+
+    for (auto *doc : reloaded)
+    {
+        if (const char *error = reload_document(*doc))
+            reloadError = error;
+    }
+
+    global.statusText = "Rewrote " + std::to_string(stats.entries) + " entries in " + std::to_string(stats.changed) + " of " + std::to_string(stats.maps) + " maps.";
+    if (!reloaded.empty())
+        global.statusText += " Reloaded open tabs: " + document_titles(reloaded) + ".";
+    if (reloadError)
+        global.statusText += std::string(" ") + reloadError;
+    if (!failures.empty())
+        global.statusText += " " + failures.front() + (failures.size() > 1 ? " (+" + std::to_string(failures.size() - 1) + " more)" : "");
+}
+
+void export_profiler_trace(void)
+{
+#ifdef PARALLAX_PROFILER
+    std::string s;
+    if (FileDialog::Open(FileDialog::Mode::Save, { {"Chrome Trace", "json"} }, s))
+    {
+        const char *error = profiler_export_trace(s);
+        global.statusText = error ? error : "Trace written to " + s;
+    }
+#endif
+}
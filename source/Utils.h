@@ -13,9 +13,18 @@ enum Mask : short
     FlipY = 0x800
 };
 
+void new_document(void);
+void close_document(void);
 void open_tilemap(void);
 void save_tilemap(void);
 void save_as_tilemap(void);
+void resize_tilemap(int width, int height);
 void open_primary_tileset(void);
 void open_secondary_tileset(void);
+void open_tilesets(void);
 void open_palettes(void);
+void import_tilemap(void);
+void replace_tiles_in_project(void);
+void optimize_tileset(void);
+void show_find_tile(void);
+void export_profiler_trace(void);
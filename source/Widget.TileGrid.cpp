@@ -0,0 +1,64 @@
+#define IMGUI_DEFINE_MATH_OPERATORS
+#include "Widget.TileGrid.h"
+#include <imgui_internal.h>
+
+#include <algorithm>
+#include <cmath>
+
+ImVec2 tile_grid_cell_pos(const TileGrid &grid, int x, int y)
+{
+    return grid.origin + ImVec2(x, y) * grid.cellSize;
+}
+
+// Draws the visible part of the texture as a single image and resolves the
+// hovered cell from the mouse position, so the cost does not depend on the
+// number of cells. Without a texture only the visible cell range is reported
+// and drawing is left to the caller.
+void tile_grid(const char *id, TileGrid &grid)
+{
+    auto drawList = ImGui::GetWindowDrawList();
+
+    grid.origin = ImGui::GetCursorScreenPos() + ImVec2(0.5f, 0.5f);
+    grid.visibleX0 = grid.visibleY0 = grid.visibleX1 = grid.visibleY1 = 0;
+    grid.hovered = false;
+
+    ImVec2 gridSize = ImVec2(grid.columns, grid.rows) * grid.cellSize;
+    ImRect bb(ImGui::GetCursorScreenPos(), ImGui::GetCursorScreenPos() + gridSize + ImVec2(1.0f, 1.0f));
+
+    ImGui::ItemSize(bb);
+
+    ImGuiID itemId = ImGui::GetID(id);
+    if (!ImGui::ItemAdd(bb, itemId))
+        return;
+
+    ImVec2 clipMin = ImMax(drawList->GetClipRectMin(), grid.origin);
+    ImVec2 clipMax = ImMin(drawList->GetClipRectMax(), grid.origin + gridSize);
+
+    int x0 = std::clamp<int>(std::floor((clipMin.x - grid.origin.x) / grid.cellSize), 0, grid.columns);
+    int y0 = std::clamp<int>(std::floor((clipMin.y - grid.origin.y) / grid.cellSize), 0, grid.rows);
+    int x1 = std::clamp<int>(std::ceil((clipMax.x - grid.origin.x) / grid.cellSize), 0, grid.columns);
+    int y1 = std::clamp<int>(std::ceil((clipMax.y - grid.origin.y) / grid.cellSize), 0, grid.rows);
+
+    grid.visibleX0 = x0;
+    grid.visibleY0 = y0;
+    grid.visibleX1 = x1;
+    grid.visibleY1 = y1;
+
+    if (grid.texture && x0 < x1 && y0 < y1)
+    {
+        ImVec2 uvScale = (grid.uv1 - grid.uv0) / ImVec2(grid.columns, grid.rows);
+        ImVec2 uv0 = grid.uv0 + ImVec2(x0, y0) * uvScale;
+        ImVec2 uv1 = grid.uv0 + ImVec2(x1, y1) * uvScale;
+        drawList->AddImage(grid.texture, tile_grid_cell_pos(grid, x0, y0), tile_grid_cell_pos(grid, x1, y1), uv0, uv1);
+    }
+
+    if (ImGui::ItemHoverable(bb, itemId, ImGuiItemFlags_AllowOverlap))
+    {
+        ImVec2 cell = (ImGui::GetIO().MousePos - grid.origin) / grid.cellSize;
+        int x = std::clamp<int>(std::floor(cell.x), 0, grid.columns - 1);
+        int y = std::clamp<int>(std::floor(cell.y), 0, grid.rows - 1);
+
+        grid.hovered = true;
+        grid.hoveredCell = x + y * grid.columns;
+    }
+}
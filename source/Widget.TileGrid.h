@@ -0,0 +1,20 @@
+#pragma once
+
+#include <imgui.h>
+
+struct TileGrid
+{
+    ImTextureID texture;
+    ImVec2 uv0 = ImVec2(0.0f, 0.0f), uv1 = ImVec2(1.0f, 1.0f); // Part of the texture covering the grid.
+    int columns, rows;
+    float cellSize;
+
+    // Filled in by tile_grid().
+    ImVec2 origin;
+    int visibleX0, visibleY0, visibleX1, visibleY1;
+    bool hovered;
+    int hoveredCell;
+};
+
+void tile_grid(const char *id, TileGrid &grid);
+ImVec2 tile_grid_cell_pos(const TileGrid &grid, int x, int y);